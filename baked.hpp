@@ -0,0 +1,258 @@
+// Copyright (c) 2022  Zubax Robotics  <info@zubax.com>
+
+#pragma once
+
+#include "layout.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+
+/// For a fixed set of layout views and the fixed flippable bits at the beginning of the file name, the linear system
+/// that the solver has to eliminate does not depend on the seed: only its right-hand side does.
+/// The elimination is therefore performed once at compile time for every combination of views the solver is
+/// instantiated with, and a solve reduces to a bit-matrix-vector product evaluated with one table lookup per byte of
+/// the right-hand side.
+namespace baked
+{
+
+/// A vector over GF(2) usable in constant expressions.
+template <std::size_t Bits>
+struct BitVector final
+{
+    static constexpr std::size_t WordBits  = 64U;
+    static constexpr std::size_t WordCount = (Bits + WordBits - 1U) / WordBits;
+
+    std::array<std::uint64_t, WordCount> words{};
+
+    constexpr bool get(const std::size_t index) const
+    {
+        return ((words.at(index / WordBits) >> (index % WordBits)) & 1U) != 0;
+    }
+    constexpr void flip(const std::size_t index)
+    {
+        words.at(index / WordBits) ^= std::uint64_t{1} << (index % WordBits);
+    }
+
+    /// Byte i of the vector, little-endian.
+    constexpr std::uint8_t getByte(const std::size_t index) const
+    {
+        return static_cast<std::uint8_t>(words.at(index / sizeof(std::uint64_t)) >>
+                                         ((index % sizeof(std::uint64_t)) * CHAR_BIT));
+    }
+
+    constexpr bool isZero() const
+    {
+        return std::all_of(words.begin(), words.end(), [](const std::uint64_t w) { return w == 0; });
+    }
+    constexpr std::size_t count() const
+    {
+        std::size_t out = 0;
+        for (const auto w : words)
+        {
+            out += static_cast<std::size_t>(std::popcount(w));
+        }
+        return out;
+    }
+
+    constexpr BitVector& operator^=(const BitVector& other)
+    {
+        for (std::size_t i = 0; i < WordCount; i++)
+        {
+            words.at(i) ^= other.words.at(i);
+        }
+        return *this;
+    }
+    constexpr bool operator==(const BitVector& other) const = default;
+};
+
+/// Forges a request that is accepted under every one of the given views at once by stacking their equations.
+/// Each view contributes 64 equations (one per bit of its CRC residual) and 64 flippable bits at the beginning of
+/// the file name, so that the system stays square; views that are linearly dependent merely reduce the rank.
+template <typename... Views>
+struct Solver final
+{
+    static_assert(sizeof...(Views) > 0);
+
+    static constexpr std::size_t EquationCount = sizeof...(Views) * hash::CRC64WE::Size * CHAR_BIT;
+    static constexpr std::size_t VariableCount = EquationCount;
+
+    /// The file name bits that are stored by every writer layout.
+    static constexpr std::size_t FileNameBits =
+        std::min({layout::Request::MaxFileNameSize, Views::WriterLayout::FileName.size...}) * CHAR_BIT;
+    static_assert(VariableCount <= FileNameBits, "The flippable bits shall fit into the file name of every layout");
+
+    /// True if the request has to be accepted under the given view among others.
+    template <typename View>
+    static constexpr bool Includes = (std::is_same_v<View, Views> || ...);
+
+    using Equations = BitVector<EquationCount>;
+    using Variables = BitVector<VariableCount>;
+
+    /// The residuals of all views concatenated; the bootloaders accept the request iff it is zero.
+    static constexpr Equations residual(const layout::Request& req)
+    {
+        Equations   out{};
+        std::size_t i = 0;
+        ((out.words.at(i++) = Views::residual(req)), ...);
+        return out;
+    }
+
+    /// Variable j is bit j of the file name, counting from the LSB of the first byte.
+    static constexpr layout::Request apply(layout::Request req, const Variables& x)
+    {
+        for (std::size_t j = 0; j < VariableCount; j++)
+        {
+            if (x.get(j))
+            {
+                req.flipFileNameBit(j);
+            }
+        }
+        return req;
+    }
+
+    /// Returns the bits to flip in the file name such that every bootloader accepts the request,
+    /// or empty if there is no solution with these bits.
+    static constexpr std::optional<Variables> solve(const layout::Request& req);
+
+    /// The result of the compile-time elimination, tabulated per byte of the right-hand side d:
+    /// x(d) = XOR of Table[i][byte i of d].x; the system is consistent iff the same XOR of the syndromes is zero.
+    struct Entry final
+    {
+        Variables x;
+        Equations syndrome;
+    };
+    using Table = std::array<std::array<Entry, 256>, EquationCount / CHAR_BIT>;
+
+    static consteval Table bake()
+    {
+        // Row i of A is equation i; bit j of the row is the effect of flipping variable j.
+        // The residual is affine in the request bits, so the columns are taken relative to the zero request.
+        std::array<Variables, EquationCount> a{};
+        std::array<Equations, EquationCount> e{};  // The row operations applied so far, to be applied to d.
+        const layout::Request                zero{};
+        const auto                           base = residual(zero);
+        for (std::size_t j = 0; j < VariableCount; j++)
+        {
+            auto req = zero;
+            req.flipFileNameBit(j);
+            auto column = residual(req);
+            column ^= base;
+            for (std::size_t i = 0; i < EquationCount; i++)
+            {
+                if (column.get(i))
+                {
+                    a.at(i).flip(j);
+                }
+            }
+        }
+        for (std::size_t i = 0; i < EquationCount; i++)
+        {
+            e.at(i).flip(i);
+        }
+        // Gauss-Jordan elimination with the pivots chosen leftmost-first, so that the free variables are the last ones.
+        std::array<std::size_t, EquationCount> pivot_columns{};
+        std::size_t                            rank = 0;
+        for (std::size_t j = 0; (j < VariableCount) && (rank < EquationCount); j++)
+        {
+            std::size_t p = rank;
+            while ((p < EquationCount) && !a.at(p).get(j))
+            {
+                p++;
+            }
+            if (p == EquationCount)
+            {
+                continue;
+            }
+            std::swap(a.at(p), a.at(rank));
+            std::swap(e.at(p), e.at(rank));
+            for (std::size_t i = 0; i < EquationCount; i++)
+            {
+                if ((i != rank) && a.at(i).get(j))
+                {
+                    a.at(i) ^= a.at(rank);
+                    e.at(i) ^= e.at(rank);
+                }
+            }
+            pivot_columns.at(rank++) = j;
+        }
+        // The response to each individual bit of d, then combined into per-byte tables.
+        std::array<Entry, EquationCount> unit{};
+        for (std::size_t t = 0; t < EquationCount; t++)
+        {
+            for (std::size_t k = 0; k < EquationCount; k++)
+            {
+                if (e.at(k).get(t))
+                {
+                    if (k < rank)
+                    {
+                        unit.at(t).x.flip(pivot_columns.at(k));
+                    }
+                    else
+                    {
+                        unit.at(t).syndrome.flip(k);
+                    }
+                }
+            }
+        }
+        // Each entry differs from an already computed one by the lowest set bit of its index.
+        Table out{};
+        for (std::size_t i = 0; i < out.size(); i++)
+        {
+            for (std::size_t b = 1; b < out.at(i).size(); b++)
+            {
+                const auto& u   = unit.at((i * CHAR_BIT) + static_cast<std::size_t>(std::countr_zero(b)));
+                auto&       dst = out.at(i).at(b);
+                dst             = out.at(i).at(b & (b - 1U));
+                dst.x ^= u.x;
+                dst.syndrome ^= u.syndrome;
+            }
+        }
+        return out;
+    }
+};
+
+/// One table per combination of views, evaluated at compile time when the solver is instantiated.
+template <typename... Views>
+inline constexpr typename Solver<Views...>::Table Baked = Solver<Views...>::bake();
+
+template <typename... Views>
+constexpr std::optional<typename Solver<Views...>::Variables> Solver<Views...>::solve(const layout::Request& req)
+{
+    const auto d = residual(req);
+    Entry      acc{};
+    for (std::size_t i = 0; i < Baked<Views...>.size(); i++)
+    {
+        const auto& entry = Baked<Views...>.at(i).at(d.getByte(i));
+        acc.x ^= entry.x;
+        acc.syndrome ^= entry.syndrome;
+    }
+    if (!acc.syndrome.isZero())
+    {
+        return {};
+    }
+    return acc.x;
+}
+
+namespace detail
+{
+/// The example from the README: ./solver 1000000 125 127
+constexpr layout::Request makeKnownSeed()
+{
+    layout::Request req{};
+    req.can_bus_speed            = 1000000;
+    req.uavcan_node_id           = 125;
+    req.uavcan_fw_server_node_id = 127;
+    return req;
+}
+using LegacyV02Solver = Solver<layout::LegacyV02View>;
+constexpr auto KnownSolution = LegacyV02Solver::solve(makeKnownSeed());
+static_assert(KnownSolution->words.at(0) == 0x3AFB'9A96'C464'E88EULL);
+static_assert(LegacyV02Solver::residual(LegacyV02Solver::apply(makeKnownSeed(), *KnownSolution)).isZero());
+}  // namespace detail
+
+}  // namespace baked
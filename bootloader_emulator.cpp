@@ -0,0 +1,269 @@
+// Copyright (c) 2022  Zubax Robotics  <info@zubax.com>
+//
+// End-to-end load test of forged update requests against emulated legacy bootloader nodes. Every node owns a POSIX
+// shared memory region standing in for the memory shared between its application and its bootloader.
+// For each request, the emulated application writes the struct carrying the solver output into the region using
+// composeWithLeadingCRC(), then the emulated bootloader parses the region using parseWithTrailingCRC().
+// Each forged request is followed by a negative control: the same request without forging, which the bootloader
+// shall reject. Usage:
+//
+//  ./bootloader_emulator [--nodes N] [--threads N] [--duration SECONDS]
+//
+// The exit code is zero if the bootloaders accepted every forged request and rejected every control request.
+
+#include "app_shared.hpp"
+#include "baked.hpp"
+#include "layout.hpp"
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace bootloader_emulator
+{
+namespace
+{
+
+using Solver = baked::Solver<layout::LegacyV02View>;
+using Writer = layout::LegacyV02Application;
+
+/// The region holds the wrapper written by the application: the CRC followed by the struct.
+constexpr std::size_t RegionSize = sizeof(decltype(app_shared::composeWithLeadingCRC(app_shared::LegacyV02{})));
+
+constexpr std::array<std::uint32_t, 4> CANBusSpeeds{125'000, 250'000, 500'000, 1'000'000};
+constexpr std::uint8_t                 NodeIDMax = 125U;  ///< The IDs above are reserved for the servers.
+constexpr std::size_t                  PathSize  = 32U;   ///< Including the bytes reserved for the solution.
+
+/// A shared memory object mapped into the process. The name is unlinked right after mapping, so the object
+/// disappears when the mapping is released even if the process is terminated abnormally.
+class SharedRegion final
+{
+public:
+    explicit SharedRegion(const std::string& name)
+    {
+        const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+        void* const map = (::ftruncate(fd, RegionSize) == 0)
+                              ? ::mmap(nullptr, RegionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                              : MAP_FAILED;
+        const auto  error = errno;
+        (void) ::close(fd);
+        (void) ::shm_unlink(name.c_str());
+        if (map == MAP_FAILED)
+        {
+            throw std::system_error(error, std::generic_category(), "mmap " + name);
+        }
+        data_ = static_cast<std::uint8_t*>(map);
+    }
+
+    ~SharedRegion()
+    {
+        if (data_ != nullptr)
+        {
+            (void) ::munmap(data_, RegionSize);
+        }
+    }
+
+    SharedRegion(SharedRegion&& other) noexcept : data_(std::exchange(other.data_, nullptr)) {}
+    SharedRegion(const SharedRegion&)            = delete;
+    SharedRegion& operator=(const SharedRegion&) = delete;
+    SharedRegion& operator=(SharedRegion&&)      = delete;
+
+    [[nodiscard]] std::uint8_t* data() const { return data_; }
+
+private:
+    std::uint8_t* data_ = nullptr;
+};
+
+struct Node final
+{
+    std::uint8_t node_id;
+    SharedRegion region;
+};
+
+struct Stats final
+{
+    std::uint64_t requests           = 0;  ///< Solver invocations.
+    std::uint64_t solved             = 0;  ///< Requests for which the solver found a solution.
+    std::uint64_t forged_accepted    = 0;  ///< Solved requests accepted by the bootloader; shall equal `solved`.
+    std::uint64_t control_accepted   = 0;  ///< Unforged requests accepted by the bootloader; shall be zero.
+    std::uint64_t model_disagreement = 0;  ///< The bootloader disagreed with Solver::residual(); shall be zero.
+
+    Stats& operator+=(const Stats& other)
+    {
+        requests += other.requests;
+        solved += other.solved;
+        forged_accepted += other.forged_accepted;
+        control_accepted += other.control_accepted;
+        model_disagreement += other.model_disagreement;
+        return *this;
+    }
+};
+
+/// The application writes the request into the shared region, then the bootloader reads it back.
+/// On a real node they never run concurrently (the bootloader starts after the reboot), so both run here in turn.
+bool transfer(Node& node, const layout::Request& req)
+{
+    const auto obj    = std::bit_cast<app_shared::LegacyV02>(Writer::serialize(req));
+    const auto buffer = app_shared::composeWithLeadingCRC(obj);
+    std::memcpy(node.region.data(), buffer.data(), buffer.size());
+    return app_shared::parseWithTrailingCRC<app_shared::LegacyV02>(node.region.data()).has_value();
+}
+
+/// Processes one request per node per round until the deadline.
+Stats worker(std::vector<Node>& nodes, const std::uint64_t seed, const std::chrono::steady_clock::time_point deadline)
+{
+    std::mt19937_64                              rng{seed};
+    std::uniform_int_distribution<std::size_t>   dist_speed{0, CANBusSpeeds.size() - 1U};
+    std::uniform_int_distribution<std::uint16_t> dist_ascii{0x20, 0x7E};
+    Stats                                        out;
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        for (auto& node : nodes)
+        {
+            // The firmware server varies across the fleet; the path follows the bytes reserved for the solution.
+            layout::Request req{};
+            req.can_bus_speed            = CANBusSpeeds.at(dist_speed(rng));
+            req.uavcan_node_id           = node.node_id;
+            req.uavcan_fw_server_node_id = static_cast<std::uint8_t>(NodeIDMax + 1U + (out.requests % 2U));
+            const auto name = req.uavcan_file_name.begin();
+            std::generate(name + static_cast<std::ptrdiff_t>(Solver::VariableCount / CHAR_BIT),
+                          name + static_cast<std::ptrdiff_t>(PathSize),
+                          [&]() { return static_cast<char>(dist_ascii(rng)); });
+            out.requests++;
+            if (const auto solution = Solver::solve(req))
+            {
+                out.solved++;
+                const auto forged   = Solver::apply(req, *solution);
+                const bool accepted = transfer(node, forged);
+                out.forged_accepted += accepted ? 1U : 0U;
+                out.model_disagreement += (accepted != Solver::residual(forged).isZero()) ? 1U : 0U;
+            }
+            const bool accepted = transfer(node, req);
+            out.control_accepted += accepted ? 1U : 0U;
+            out.model_disagreement += (accepted != Solver::residual(req).isZero()) ? 1U : 0U;
+        }
+    }
+    return out;
+}
+
+}  // namespace
+}  // namespace bootloader_emulator
+
+int main(const int argc, const char* const argv[])
+{
+    std::size_t          node_count = 4096;
+    std::chrono::seconds duration(10);
+    auto                 thread_count = std::max(1U, std::thread::hardware_concurrency());
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string a(argv[i]);
+            if (++i >= argc)
+            {
+                throw std::invalid_argument(a + " requires a value");
+            }
+            if (a == "--nodes")
+            {
+                node_count = std::stoul(argv[i]);
+            }
+            else if (a == "--threads")
+            {
+                thread_count = static_cast<std::uint32_t>(std::stoul(argv[i]));
+            }
+            else if (a == "--duration")
+            {
+                duration = std::chrono::seconds(std::stoul(argv[i]));
+            }
+            else
+            {
+                throw std::invalid_argument("unknown option " + a);
+            }
+        }
+        if ((node_count == 0) || (thread_count == 0))
+        {
+            throw std::invalid_argument("the node and thread counts shall be positive");
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Invalid usage: " << ex.what() << std::endl;
+        return 1;
+    }
+    thread_count = static_cast<std::uint32_t>(std::min<std::size_t>(thread_count, node_count));
+
+    // Each worker owns a disjoint subset of the nodes, so the regions are never shared between threads.
+    std::vector<std::vector<bootloader_emulator::Node>> partitions(thread_count);
+    try
+    {
+        const auto prefix = "/bootloader_emulator." + std::to_string(::getpid()) + ".";
+        for (std::size_t i = 0; i < node_count; i++)
+        {
+            partitions.at(i % thread_count)
+                .push_back({static_cast<std::uint8_t>(1U + (i % bootloader_emulator::NodeIDMax)),
+                            bootloader_emulator::SharedRegion(prefix + std::to_string(i))});
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Could not set up the nodes: " << ex.what() << std::endl;
+        return 1;
+    }
+    std::cerr << "Emulating " << node_count << " nodes for " << duration.count() << " s using " << thread_count
+              << " threads" << std::endl;
+
+    std::random_device                      rnd_device;
+    std::vector<bootloader_emulator::Stats> stats(thread_count);
+    std::vector<std::thread>                threads;
+    threads.reserve(thread_count);
+    const auto started_at = std::chrono::steady_clock::now();
+    const auto deadline   = started_at + duration;
+    for (std::uint32_t i = 0; i < thread_count; i++)
+    {
+        const auto seed = (static_cast<std::uint64_t>(rnd_device()) << 32U) | rnd_device();
+        threads.emplace_back([&, i, seed]()
+                             { stats.at(i) = bootloader_emulator::worker(partitions.at(i), seed, deadline); });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
+                             std::chrono::steady_clock::now() - started_at)
+                             .count();
+
+    bootloader_emulator::Stats total;
+    for (const auto& s : stats)
+    {
+        total += s;
+    }
+    const auto ratio = [](const std::uint64_t num, const std::uint64_t den)
+    { return (den > 0) ? (static_cast<double>(num) * 100.0 / static_cast<double>(den)) : 0.0; };
+    std::cout << "Requests:           " << total.requests << " (" << (static_cast<double>(total.requests) / elapsed)
+              << " per second)\n"
+              << "Solved:             " << total.solved << " (" << ratio(total.solved, total.requests) << "%)\n"
+              << "Forged accepted:    " << total.forged_accepted << " ("
+              << ratio(total.forged_accepted, total.solved) << "% of solved)\n"
+              << "Control accepted:   " << total.control_accepted << " ("
+              << ratio(total.control_accepted, total.requests) << "%)\n"
+              << "Model disagreement: " << total.model_disagreement << std::endl;
+    const bool ok = (total.forged_accepted == total.solved) && (total.control_accepted == 0) &&
+                    (total.model_disagreement == 0);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,287 @@
+// Copyright (c) 2022  Zubax Robotics  <info@zubax.com>
+//
+// Computes CRC-64/WE over firmware images and optionally patches it into the image descriptor in place. Usage:
+//
+//  ./crc64we [--threads N] [--patch OFFSET] [--verify] FILE...
+//
+// For every file, the CRC and whether the file ends with a valid CRC (the residue check) are printed.
+// With --patch, the CRC is computed with the 8 bytes at OFFSET treated as zeros and then stored there as a
+// little-endian 64-bit integer, which is how the image descriptor carries it. With --verify, files that do not
+// pass the residue check are reported as errors. The special file name "-" denotes the standard input.
+
+#include "hash.hpp"
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace crc64we
+{
+namespace
+{
+
+constexpr std::size_t ReadBlockSize = 4U * 1024U * 1024U;  ///< Used when the input cannot be memory-mapped.
+constexpr std::size_t ReadAlignment = 4096U;
+
+struct Result final
+{
+    std::uint64_t crc     = 0;
+    bool          residue = false;
+    std::string   error;  ///< Empty on success.
+};
+
+/// Feeds the data into the CRC; the bytes in [patch_offset, patch_offset + 8) read as zeros if the offset is given.
+/// `position` is the offset of the data from the beginning of the file.
+void update(hash::CRC64WE&                   crc,
+            const std::uint8_t* const        data,
+            const std::size_t                size,
+            const std::size_t                position,
+            const std::optional<std::size_t> patch_offset)
+{
+    if (!patch_offset || ((position + size) <= *patch_offset) || (position >= (*patch_offset + hash::CRC64WE::Size)))
+    {
+        crc.update(data, size);
+        return;
+    }
+    static constexpr std::array<std::uint8_t, hash::CRC64WE::Size> Zeros{};
+    const auto begin = std::max(position, *patch_offset) - position;
+    const auto end   = std::min(position + size, *patch_offset + hash::CRC64WE::Size) - position;
+    crc.update(data, begin);
+    crc.update(Zeros.data(), end - begin);
+    crc.update(data + end, size - end);
+}
+
+/// Reads the input sequentially into a page-aligned buffer; used for pipes, devices, and the standard input.
+Result processStream(const int fd)
+{
+    Result        out;
+    hash::CRC64WE crc;
+    const std::unique_ptr<std::uint8_t, decltype(&std::free)> buffer(
+        static_cast<std::uint8_t*>(std::aligned_alloc(ReadAlignment, ReadBlockSize)),
+        &std::free);
+    if (!buffer)
+    {
+        out.error = "out of memory";
+        return out;
+    }
+    (void) ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    for (;;)
+    {
+        const auto n = ::read(fd, buffer.get(), ReadBlockSize);
+        if (n == 0)
+        {
+            break;
+        }
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            out.error = std::strerror(errno);
+            return out;
+        }
+        crc.update(buffer.get(), static_cast<std::size_t>(n));
+    }
+    out.crc     = crc.get();
+    out.residue = crc.isResidueCorrect();
+    return out;
+}
+
+Result processFile(const std::string& name, const std::optional<std::size_t> patch_offset)
+{
+    Result out;
+    if (name == "-")
+    {
+        if (patch_offset)
+        {
+            out.error = "cannot patch the standard input";
+            return out;
+        }
+        return processStream(STDIN_FILENO);
+    }
+    const int fd = ::open(name.c_str(), patch_offset ? O_RDWR : O_RDONLY);
+    if (fd < 0)
+    {
+        out.error = std::strerror(errno);
+        return out;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0)
+    {
+        out.error = std::strerror(errno);
+        (void) ::close(fd);
+        return out;
+    }
+    if (!S_ISREG(st.st_mode))
+    {
+        if (patch_offset)
+        {
+            out.error = "cannot patch a file that is not a regular file";
+        }
+        else
+        {
+            out = processStream(fd);
+        }
+        (void) ::close(fd);
+        return out;
+    }
+    const auto size = static_cast<std::size_t>(st.st_size);
+    if (patch_offset && ((*patch_offset > size) || ((size - *patch_offset) < hash::CRC64WE::Size)))
+    {
+        out.error = "the patch offset is beyond the end of the file";
+        (void) ::close(fd);
+        return out;
+    }
+    void* const map =
+        (size > 0) ? ::mmap(nullptr, size, PROT_READ | (patch_offset ? PROT_WRITE : 0), MAP_SHARED, fd, 0) : nullptr;
+    (void) ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        out.error = std::strerror(errno);
+        return out;
+    }
+    hash::CRC64WE crc;
+    if (map != nullptr)
+    {
+        (void) ::madvise(map, size, MADV_SEQUENTIAL);
+        update(crc, static_cast<const std::uint8_t*>(map), size, 0, patch_offset);
+    }
+    out.crc     = crc.get();
+    out.residue = crc.isResidueCorrect();
+    if (patch_offset)
+    {
+        auto* const field = static_cast<std::uint8_t*>(map) + *patch_offset;
+        auto        value = out.crc;
+        for (std::size_t i = 0; i < hash::CRC64WE::Size; i++)  // Little-endian regardless of the host.
+        {
+            field[i] = static_cast<std::uint8_t>(value);
+            value >>= 8U;
+        }
+        if (::msync(map, size, MS_SYNC) != 0)
+        {
+            out.error = std::strerror(errno);
+        }
+    }
+    if (map != nullptr)
+    {
+        (void) ::munmap(map, size);
+    }
+    return out;
+}
+
+}  // namespace
+}  // namespace crc64we
+
+int main(const int argc, const char* const argv[])
+{
+    std::vector<std::string>   files;
+    std::optional<std::size_t> patch_offset;
+    bool                       verify       = false;
+    auto                       thread_count = std::max(1U, std::thread::hardware_concurrency());
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string a(argv[i]);
+            if ((a == "--threads") || (a == "--patch"))
+            {
+                if (++i >= argc)
+                {
+                    throw std::invalid_argument(a + " requires a value");
+                }
+                if (a == "--threads")
+                {
+                    thread_count = static_cast<std::uint32_t>(std::stoul(argv[i]));
+                }
+                else
+                {
+                    const std::string value(argv[i]);
+                    if (value.find('-') != std::string::npos)  // std::stoull() would wrap a negative value around.
+                    {
+                        throw std::invalid_argument("the patch offset shall not be negative");
+                    }
+                    patch_offset = static_cast<std::size_t>(std::stoull(value, nullptr, 0));
+                }
+            }
+            else if (a == "--verify")
+            {
+                verify = true;
+            }
+            else
+            {
+                files.push_back(a);
+            }
+        }
+        if (thread_count == 0)
+        {
+            throw std::invalid_argument("the thread count shall be positive");
+        }
+        if (files.empty())
+        {
+            throw std::invalid_argument("expected one or more file names");
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Invalid usage: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    // The files are processed in parallel one per worker; each worker takes the next unprocessed file.
+    std::vector<crc64we::Result> results(files.size());
+    std::atomic<std::size_t>     next_file{0};
+    std::vector<std::thread>     threads;
+    thread_count = std::min(thread_count, static_cast<std::uint32_t>(files.size()));
+    threads.reserve(thread_count);
+    for (std::uint32_t i = 0; i < thread_count; i++)
+    {
+        threads.emplace_back(
+            [&]()
+            {
+                for (auto k = next_file++; k < files.size(); k = next_file++)
+                {
+                    results.at(k) = crc64we::processFile(files.at(k), patch_offset);
+                }
+            });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    int result = 0;
+    for (std::size_t k = 0; k < files.size(); k++)
+    {
+        const auto& r = results.at(k);
+        if (!r.error.empty())
+        {
+            std::cerr << files.at(k) << ": " << r.error << std::endl;
+            result = 1;
+            continue;
+        }
+        std::cout.width(16);
+        std::cout.fill('0');
+        std::cout << std::hex << r.crc << std::dec << ' ';
+        std::cout << (patch_offset ? "patched" : (r.residue ? "residue-ok" : "-")) << ' ' << files.at(k) << '\n';
+        if (verify && !patch_offset && !r.residue)
+        {
+            std::cerr << files.at(k) << ": residue check failed" << std::endl;
+            result = 1;
+        }
+    }
+    std::cout << std::flush;
+    return result;
+}
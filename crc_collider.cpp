@@ -2,14 +2,27 @@
 
 #include "hash.hpp"
 #include "app_shared.hpp"
+#include "perf.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <mutex>
 #include <random>
 #include <thread>
 #include <vector>
 #include <numeric>
+#include <optional>
 #include <iostream>
 #include <algorithm>
 #include <syncstream>
 #include <functional>
+#include <condition_variable>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
 
 #define DEBUG 0
 
@@ -40,6 +53,13 @@ void worker(const app_shared::LegacyV02& seed, const std::function<void(std::uin
     auto* const nonce_ptr = reinterpret_cast<std::uint64_t*>(
         nonce_ptr_unaligned - (reinterpret_cast<std::uintptr_t>(nonce_ptr_unaligned) % alignof(std::uint64_t)));
     REQUIRE(reinterpret_cast<std::size_t>(nonce_ptr) % alignof(std::uint64_t) == 0);
+#if PERF_COUNTERS
+    // Each candidate is hashed twice: once by the composer and once by the parser.
+    constexpr std::uint64_t PerfReportPeriod  = NotifierPeriod * 16U;
+    constexpr auto          BytesPerCandidate = 2U * sizeof(app_shared::LegacyV02);
+    const perf::Counters    counters;
+    auto                    perf_snapshot = counters.read();
+#endif
     for (std::uint64_t i = 0; i < std::numeric_limits<std::uint64_t>::max(); i++)
     {
         (*nonce_ptr)++;
@@ -53,6 +73,20 @@ void worker(const app_shared::LegacyV02& seed, const std::function<void(std::uin
         {
             [[unlikely]] progress_reporter(i);
         }
+#if PERF_COUNTERS
+        if ((i > 0) && (0 == (i % PerfReportPeriod))) [[unlikely]]
+        {
+            const auto       now   = counters.read();
+            const auto       delta = now - perf_snapshot;
+            perf_snapshot          = now;
+            std::osyncstream os(std::cerr);
+            os << "\nThread " << std::this_thread::get_id() << ": ";
+            counters.report(os, delta, static_cast<double>(PerfReportPeriod), "candidate");
+            os << "; ";
+            counters.report(os, delta, static_cast<double>(PerfReportPeriod * BytesPerCandidate), "byte");
+            os << std::endl;
+        }
+#endif
 #if DEBUG
         {
             std::osyncstream os(std::cerr);
@@ -85,12 +119,202 @@ void testCRC64WE()
     REQUIRE(0xFCAC'BEBD'5931'A992ULL == (~crc.get()));
 }
 
+#if PERF_COUNTERS
+/// Measures the bare CRC64WE::update() throughput on a buffer that fits in L1D, free from the collider overheads.
+void measureCRC64WE()
+{
+    constexpr std::size_t                BufferSize = 16U * 1024U;
+    constexpr std::size_t                Rounds     = 4096U;
+    std::array<std::uint8_t, BufferSize> buffer{};
+    std::iota(buffer.begin(), buffer.end(), 0U);
+    const perf::Counters counters;
+    hash::CRC64WE        crc;
+    const auto           before = counters.read();
+    for (std::size_t i = 0; i < Rounds; i++)
+    {
+        crc.update(buffer.data(), buffer.size());
+    }
+    const auto delta = counters.read() - before;
+    REQUIRE(crc.get() != 0);  // Keep the computation observable.
+    std::cerr << "CRC64WE::update(): ";
+    counters.report(std::cerr, delta, static_cast<double>(BufferSize * Rounds), "byte");
+    std::cerr << (counters.isPrecise() ? "" : " (PMU unavailable, using TSC)") << std::endl;
+}
+#endif
+
+/// Moves the calling thread to SCHED_IDLE and the lowest nice level, so that it only consumes the cycles that no other
+/// task on the host wants. The nice level is per-thread on Linux and still matters if SCHED_IDLE is unavailable.
+void enterBackground()
+{
+    constexpr int     LowestPriority = 19;
+    const sched_param param{};
+    if (const int err = ::pthread_setschedparam(::pthread_self(), SCHED_IDLE, &param); err != 0)
+    {
+        std::osyncstream(std::cerr) << "Could not switch to SCHED_IDLE: " << std::strerror(err) << std::endl;
+    }
+    if (::setpriority(PRIO_PROCESS, static_cast<id_t>(::gettid()), LowestPriority) != 0)
+    {
+        std::osyncstream(std::cerr) << "Could not change the nice level: " << std::strerror(errno) << std::endl;
+    }
+}
+
+/// Limits the number of running workers. The workers call await() at chunk boundaries and park there while their
+/// index is not below the allowed count.
+class Throttle final
+{
+public:
+    explicit Throttle(const std::uint32_t worker_count) : allowed_(worker_count), parked_(worker_count, false) {}
+
+    void setAllowed(const std::uint32_t value)
+    {
+        {
+            std::lock_guard lock(mutex_);
+            allowed_ = value;
+        }
+        cv_.notify_all();
+    }
+
+    void await(const std::uint32_t index)
+    {
+        std::unique_lock lock(mutex_);
+        if (index < allowed_)
+        {
+            return;
+        }
+        parked_.at(index) = true;
+        cv_.wait(lock, [&]() { return index < allowed_; });
+        parked_.at(index) = false;
+    }
+
+    /// The number of workers that are not parked at the moment.
+    [[nodiscard]] std::uint32_t getActiveCount() const
+    {
+        std::lock_guard lock(mutex_);
+        return static_cast<std::uint32_t>(std::count(parked_.begin(), parked_.end(), false));
+    }
+
+private:
+    mutable std::mutex      mutex_;
+    std::condition_variable cv_;
+    std::uint32_t           allowed_;
+    std::vector<bool>       parked_;
+};
+
+/// The CPU time the thread has received so far, in seconds; zero if its CPU clock is not available.
+/// Unlike the time spent unparked, this excludes the time the thread was runnable but preempted by other tasks,
+/// which is the bulk of it in the background mode.
+double getCPUTime(std::thread& thread)
+{
+    ::clockid_t clock{};
+    ::timespec  ts{};
+    if ((::pthread_getcpuclockid(thread.native_handle(), &clock) != 0) || (::clock_gettime(clock, &ts) != 0))
+    {
+        return 0.0;
+    }
+    return static_cast<double>(ts.tv_sec) + (static_cast<double>(ts.tv_nsec) * 1e-9);
+}
+
+/// The 1-minute load average, or empty if it cannot be read.
+std::optional<double> readLoadAverage()
+{
+    std::ifstream f("/proc/loadavg");
+    double        out = 0;
+    if (f >> out)
+    {
+        return out;
+    }
+    return {};
+}
+
+/// Decides how many workers may run. The duty cycle turns all workers on and off within a fixed period.
+/// The load limit admits as many workers as fit under the target load together with the load caused by the other
+/// tasks; the latter is the load average less our own contribution, which is tracked using the same time constant
+/// as the kernel uses for the load average.
+class Controller final
+{
+public:
+    static constexpr double DutyCyclePeriod   = 10.0;  ///< [second]
+    static constexpr double LoadAveragePeriod = 60.0;  ///< [second]
+
+    Controller(const std::uint32_t          worker_count,
+               const std::optional<double> duty_cycle,
+               const std::optional<double> max_load) :
+        worker_count_(worker_count), duty_cycle_(duty_cycle), max_load_(max_load)
+    {
+    }
+
+    /// Invoked periodically with the time since the start and since the previous invocation, in seconds.
+    std::uint32_t update(const double elapsed, const double dt, const std::uint32_t active_count)
+    {
+        auto allowed = worker_count_;
+        if (duty_cycle_ && (std::fmod(elapsed, DutyCyclePeriod) >= (DutyCyclePeriod * *duty_cycle_ * 0.01)))
+        {
+            allowed = 0;
+        }
+        if (max_load_)
+        {
+            own_load_ += (static_cast<double>(active_count) - own_load_) * (1.0 - std::exp(-dt / LoadAveragePeriod));
+            if (const auto load = readLoadAverage())
+            {
+                const auto foreign = std::max(0.0, *load - own_load_);
+                const auto fit     = std::floor(std::max(0.0, *max_load_ - foreign));
+                allowed            = std::min(allowed, static_cast<std::uint32_t>(std::min(fit, 1e6)));
+            }
+        }
+        return allowed;
+    }
+
+private:
+    const std::uint32_t         worker_count_;
+    const std::optional<double> duty_cycle_;
+    const std::optional<double> max_load_;
+    double                      own_load_ = 0;
+};
+
 }  // namespace
 }  // namespace crc_collider
 
-int main()
+int main(const int argc, const char* const argv[])
 {
+    bool                  background = false;
+    std::optional<double> duty_cycle;  // [percent]
+    std::optional<double> max_load;
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string a(argv[i]);
+            if (a == "--background")
+            {
+                background = true;
+            }
+            else if (((a == "--duty-cycle") || (a == "--max-load")) && ((i + 1) < argc))
+            {
+                (a == "--duty-cycle" ? duty_cycle : max_load) = std::stod(argv[++i]);
+            }
+            else
+            {
+                throw std::invalid_argument("unexpected argument " + a);
+            }
+        }
+        if (duty_cycle && ((*duty_cycle <= 0.0) || (*duty_cycle > 100.0)))
+        {
+            throw std::invalid_argument("the duty cycle shall be in (0, 100]");
+        }
+        if (max_load && !crc_collider::readLoadAverage())
+        {
+            throw std::invalid_argument("the load average is not available on this host");
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Invalid usage: " << ex.what() << std::endl;
+        return 1;
+    }
     crc_collider::testCRC64WE();
+#if PERF_COUNTERS
+    crc_collider::measureCRC64WE();
+#endif
     app_shared::LegacyV02 obj{
         .can_bus_speed            = 1000000,
         .uavcan_node_id           = 50,
@@ -101,13 +325,18 @@ int main()
     std::random_device                          rnd_device;
     std::mt19937                                mersenne_engine{rnd_device()};
     std::uniform_int_distribution<std::uint8_t> dist_ascii{0x20, 0x7E};  // Use only printable chars for simplicity.
-    static const auto                           thread_count =
+    // In the background mode, the workers only take the cycles nobody else wants, so there is no need to spare cores.
+    static const auto thread_count =
 #if DEBUG
         1U;
 #else
-        static_cast<std::uint32_t>(std::max(1, static_cast<std::int32_t>(std::thread::hardware_concurrency()) - 2));
+        static_cast<std::uint32_t>(std::max(1,
+                                            static_cast<std::int32_t>(std::thread::hardware_concurrency()) -
+                                                (background ? 0 : 2)));
 #endif
-    std::cerr << "Thread count: " << thread_count << std::endl;
+    std::cerr << "Thread count: " << thread_count << (background ? " (background)" : "") << std::endl;
+    const bool             throttled = duty_cycle || max_load;
+    crc_collider::Throttle throttle(thread_count);
     std::mutex                 progress_mutex;
     std::vector<std::uint64_t> thread_hash_counters(thread_count, 0);
     const auto                 progress_reporter = [&](const std::size_t thread_index, const std::uint64_t hash_count)
@@ -124,29 +353,69 @@ int main()
                       obj.uavcan_file_name.end() - sizeof(std::uint64_t) - 1U,
                       [&dist_ascii, &mersenne_engine]() { return dist_ascii(mersenne_engine); });
         obj.uavcan_file_name.back() = 0;
-        threads.emplace_back(crc_collider::worker,
-                             obj,
-                             [i, &progress_reporter](const std::uint64_t hash_count)
-                             { progress_reporter(i, hash_count); });
+        // The workers are parked and unparked at chunk boundaries, where they report their progress.
+        threads.emplace_back(
+            [i, obj, background, &progress_reporter, &throttle]()
+            {
+                if (background)
+                {
+                    crc_collider::enterBackground();
+                }
+                crc_collider::worker(obj,
+                                     [i, &progress_reporter, &throttle](const std::uint64_t hash_count)
+                                     {
+                                         progress_reporter(i, hash_count);
+                                         throttle.await(i);
+                                     });
+            });
     }
-    const auto started_at = std::chrono::steady_clock::now();
+    constexpr auto           ReportPeriod  = std::chrono::seconds(10);
+    constexpr auto           ControlPeriod = std::chrono::milliseconds(500);
+    crc_collider::Controller controller(thread_count, duty_cycle, max_load);
+    const auto               started_at = std::chrono::steady_clock::now();
+    auto                     reported_at = started_at;
     while (true)  // NOLINT
     {
-        std::this_thread::sleep_for(std::chrono::seconds(10));
-        const auto    elapsed          = std::chrono::steady_clock::now() - started_at;
+        std::this_thread::sleep_for(throttled ? ControlPeriod : std::chrono::milliseconds(ReportPeriod));
+        const auto now = std::chrono::steady_clock::now();
+        if (throttled)
+        {
+            const auto to_seconds = [](const auto d)
+            { return std::chrono::duration_cast<std::chrono::duration<double>>(d).count(); };
+            throttle.setAllowed(
+                controller.update(to_seconds(now - started_at), to_seconds(ControlPeriod), throttle.getActiveCount()));
+            if ((now - reported_at) < ReportPeriod)
+            {
+                continue;
+            }
+        }
+        reported_at                    = now;
+        const auto    elapsed          = now - started_at;
         std::uint64_t total_hash_count = 0;
         {
             std::lock_guard lock(progress_mutex);
             total_hash_count = std::accumulate(thread_hash_counters.begin(), thread_hash_counters.end(), 0ULL);
         }
-        const auto hash_rate = static_cast<double>(total_hash_count) /
-                               std::chrono::duration_cast<std::chrono::duration<double>>(elapsed).count();
+        const auto elapsed_seconds = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed).count();
+        const auto hash_rate       = static_cast<double>(total_hash_count) / elapsed_seconds;
         std::osyncstream os(std::cerr);
         os << '\r'  //
            << "Elapsed " << std::chrono::duration_cast<std::chrono::minutes>(elapsed).count() << " minutes; "
            << "hash count " << (static_cast<double>(total_hash_count) * 1e-6) << " M; "
-           << "hash rate " << (hash_rate * 1e-6) << " MH/s"  //
-           << "    \r" << std::flush;
+           << "hash rate " << (hash_rate * 1e-6) << " MH/s";
+        if (throttled || background)
+        {
+            // The harvested throughput is reported per CPU-second the workers actually received from the host.
+            double cpu_seconds = 0;
+            for (auto& t : threads)
+            {
+                cpu_seconds += crc_collider::getCPUTime(t);
+            }
+            os << "; harvested: " << (cpu_seconds / elapsed_seconds) << " CPU-seconds per second, "
+               << ((static_cast<double>(total_hash_count) / std::max(cpu_seconds, 1e-9)) * 1e-6)
+               << " MH per CPU-second";
+        }
+        os << "    \r" << std::flush;
 #if DEBUG
         std::quick_exit(0);
 #endif
@@ -0,0 +1,341 @@
+// Copyright (c) 2022  Zubax Robotics  <info@zubax.com>
+//
+// Differential fuzzer for the CRC engines. Every engine is compared against the bitwise reference kernel over random
+// buffers at every alignment with arbitrary splits of the input across update() calls, and the rolling CRC is compared
+// against the reference at every window position; afterwards, the throughput of each engine is reported. Usage:
+//
+//  ./crc_fuzzer [--seed SEED] [duration_seconds [thread_count]]
+//
+// Thread i draws its cases from SEED + i; the seeds are printed so that a failure can be replayed by passing the
+// seed of the failed thread with a single thread. The exit code is zero if cases were tested and no discrepancies
+// were found.
+
+#include "app_shared.hpp"
+#include "hash.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <syncstream>
+
+namespace crc_fuzzer
+{
+namespace
+{
+
+/// Add new engines here; each one is validated against the reference of its family and benchmarked.
+using Engines = std::tuple<hash::BasicCRC64WE<hash::Kernel::Bitwise>,
+                           hash::BasicCRC64WE<hash::Kernel::Table>,
+                           hash::BasicCRC16CCITT<hash::Kernel::Bitwise>,
+                           hash::BasicCRC16CCITT<hash::Kernel::Table>>;
+
+template <typename>
+struct ReferenceOf;
+template <hash::Kernel K>
+struct ReferenceOf<hash::BasicCRC64WE<K>>
+{
+    using Type = hash::BasicCRC64WE<hash::Kernel::Bitwise>;
+};
+template <hash::Kernel K>
+struct ReferenceOf<hash::BasicCRC16CCITT<K>>
+{
+    using Type = hash::BasicCRC16CCITT<hash::Kernel::Bitwise>;
+};
+
+/// The window sizes the rolling CRC is validated with; the last one is the record size used by the dump scanner.
+using RollingWindows = std::index_sequence<1U, 8U, 13U, sizeof(app_shared::LegacyV02)>;
+
+constexpr std::size_t MaxAlignment   = 64U;
+constexpr std::size_t MaxLength      = 4096U;
+constexpr std::size_t MaxSplitLength = 32U;  ///< Inputs up to this size are tested at every two-way split point.
+
+template <hash::Kernel K>
+const char* getEngineName(const hash::BasicCRC64WE<K>&)
+{
+    switch (K)
+    {
+    case hash::Kernel::Bitwise:
+        return "CRC64WE/Bitwise";
+    case hash::Kernel::Table:
+        return "CRC64WE/Table";
+    }
+    return "?";
+}
+
+template <hash::Kernel K>
+const char* getEngineName(const hash::BasicCRC16CCITT<K>&)
+{
+    switch (K)
+    {
+    case hash::Kernel::Bitwise:
+        return "CRC16CCITT/Bitwise";
+    case hash::Kernel::Table:
+        return "CRC16CCITT/Table";
+    }
+    return "?";
+}
+
+/// Feeds the data into the engine in consecutive pieces delimited by the given split points, which may repeat
+/// to produce zero-length update() calls.
+template <typename Engine>
+Engine computeSplit(const std::uint8_t* const data, const std::size_t len, const std::vector<std::size_t>& splits)
+{
+    Engine      engine;
+    std::size_t offset = 0;
+    for (const auto s : splits)
+    {
+        engine.update(data + offset, s - offset);
+        offset = s;
+    }
+    engine.update(data + offset, len - offset);
+    return engine;
+}
+
+struct Case final
+{
+    const std::uint8_t*      data = nullptr;
+    std::size_t              len  = 0;
+    std::size_t              alignment{};
+    std::vector<std::size_t> splits;
+};
+
+void printData(std::ostream& os, const Case& cs)
+{
+    os << "data={" << std::hex;
+    for (std::size_t i = 0; i < cs.len; i++)
+    {
+        os << static_cast<std::uint16_t>(cs.data[i]) << ',';
+    }
+    os << '}' << std::dec << std::endl;
+}
+
+template <typename Engine>
+bool checkEngine(const Case& cs)
+{
+    typename ReferenceOf<Engine>::Type ref;
+    ref.update(cs.data, cs.len);
+    auto engine = computeSplit<Engine>(cs.data, cs.len, cs.splits);
+    bool ok     = (engine.get() == ref.get()) && (engine.getBytes() == ref.getBytes());
+    if (ok)
+    {
+        // Appending the CRC to the data must yield the correct residue.
+        const auto crc_bytes = engine.getBytes();
+        engine.update(crc_bytes.data(), crc_bytes.size());
+        ok = engine.isResidueCorrect();
+    }
+    if (!ok)
+    {
+        std::osyncstream os(std::cerr);
+        os << "MISMATCH: " << getEngineName(engine) << " len=" << cs.len << " alignment=" << cs.alignment
+           << " splits={";
+        for (const auto s : cs.splits)
+        {
+            os << s << ',';
+        }
+        os << "} expected=" << std::hex << ref.get() << " got=" << engine.get() << std::dec << ' ';
+        printData(os, cs);
+    }
+    return ok;
+}
+
+/// Rolls the window across the whole input; at every position, the CRC is compared against the reference computed
+/// over the same window from scratch.
+template <std::size_t Window>
+bool checkRolling(const Case& cs)
+{
+    if (cs.len < Window)
+    {
+        return true;
+    }
+    hash::RollingCRC64WE<Window> crc;
+    crc.reset(cs.data);
+    for (std::size_t p = 0; (p + Window) <= cs.len; p++)
+    {
+        if (p > 0)
+        {
+            crc.roll(cs.data[p - 1U], cs.data[p + Window - 1U]);
+        }
+        hash::BasicCRC64WE<hash::Kernel::Bitwise> ref;
+        ref.update(cs.data + p, Window);
+        if (crc.get() != ref.get())
+        {
+            std::osyncstream os(std::cerr);
+            os << "MISMATCH: RollingCRC64WE<" << Window << "> len=" << cs.len << " alignment=" << cs.alignment
+               << " position=" << p << " expected=" << std::hex << ref.get() << " got=" << crc.get() << std::dec << ' ';
+            printData(os, cs);
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Runs all engines against the reference on the given input. Small inputs are tested at every split point.
+bool checkAllEngines(Case& cs, std::mt19937_64& rng)
+{
+    const auto check = [&cs]()
+    { return std::apply([&](const auto&... e) { return (checkEngine<std::decay_t<decltype(e)>>(cs) && ...); },
+                        Engines{}); };
+    const auto check_rolling = [&cs]<std::size_t... Window>(std::index_sequence<Window...>)
+    { return (checkRolling<Window>(cs) && ...); };
+    bool ok = true;
+    if (cs.len <= MaxSplitLength)
+    {
+        for (std::size_t s = 0; ok && (s <= cs.len); s++)
+        {
+            cs.splits = {s};
+            ok        = check();
+        }
+    }
+    std::uniform_int_distribution<std::size_t> dist_split_count{0, 16};
+    std::uniform_int_distribution<std::size_t> dist_split_point{0, cs.len};
+    cs.splits.resize(dist_split_count(rng));
+    std::generate(cs.splits.begin(), cs.splits.end(), [&]() { return dist_split_point(rng); });
+    std::sort(cs.splits.begin(), cs.splits.end());
+    return ok && check() && check_rolling(RollingWindows{});
+}
+
+void worker(const std::uint64_t                         seed,
+            const std::chrono::steady_clock::time_point deadline,
+            std::atomic<std::uint64_t>&                 case_count,
+            std::atomic<bool>&                          failed) noexcept
+{
+    std::mt19937_64                              rng{seed};
+    std::uniform_int_distribution<std::uint16_t> dist_byte{0, 0xFF};
+    std::uniform_int_distribution<std::size_t>   dist_len_small{0, MaxSplitLength};
+    std::uniform_int_distribution<std::size_t>   dist_len_large{0, MaxLength};
+    // The storage is over-allocated so that the test data can be placed at any offset from a 64-byte boundary.
+    std::vector<std::uint8_t> storage(MaxLength + (MaxAlignment * 2U));
+    const auto                base_misalignment = reinterpret_cast<std::uintptr_t>(storage.data()) % MaxAlignment;
+    auto* const               aligned_base      = storage.data() + (MaxAlignment - base_misalignment);
+    std::uint64_t             local_count       = 0;
+    while ((std::chrono::steady_clock::now() < deadline) && !failed.load(std::memory_order_relaxed))
+    {
+        Case cs;
+        cs.alignment  = local_count % MaxAlignment;
+        cs.len        = ((local_count % 2U) == 0) ? dist_len_small(rng) : dist_len_large(rng);
+        auto* const p = aligned_base + cs.alignment;
+        std::generate(p, p + cs.len, [&]() { return static_cast<std::uint8_t>(dist_byte(rng)); });
+        cs.data = p;
+        if (!checkAllEngines(cs, rng))
+        {
+            failed = true;
+        }
+        local_count++;
+    }
+    case_count += local_count;
+}
+
+template <typename Engine>
+void benchmark(const std::vector<std::uint8_t>& buffer, const std::chrono::steady_clock::duration duration)
+{
+    Engine        engine;
+    std::uint64_t byte_count = 0;
+    const auto    started_at = std::chrono::steady_clock::now();
+    auto          elapsed    = std::chrono::steady_clock::duration::zero();
+    while (elapsed < duration)
+    {
+        engine.update(buffer.data(), buffer.size());
+        byte_count += buffer.size();
+        elapsed = std::chrono::steady_clock::now() - started_at;
+    }
+    const auto seconds = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed).count();
+    std::cout << getEngineName(engine) << ": " << ((static_cast<double>(byte_count) / seconds) * 1e-6) << " MB/s"
+              << " (" << std::hex << engine.get() << std::dec << ")" << std::endl;
+}
+
+}  // namespace
+}  // namespace crc_fuzzer
+
+int main(const int argc, const char* const argv[])
+{
+    std::vector<std::string>     args;
+    std::optional<std::uint64_t> base_seed;
+    std::chrono::seconds         duration(10);
+    auto                         thread_count = std::max(1U, std::thread::hardware_concurrency());
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string a(argv[i]);
+            if (a == "--seed")
+            {
+                if (++i >= argc)
+                {
+                    throw std::invalid_argument(a + " requires a value");
+                }
+                base_seed = std::stoull(argv[i], nullptr, 0);
+            }
+            else
+            {
+                args.push_back(a);
+            }
+        }
+        if (!args.empty())
+        {
+            duration = std::chrono::seconds(std::stoul(args.at(0)));
+        }
+        if (args.size() > 1)
+        {
+            thread_count = static_cast<std::uint32_t>(std::stoul(args.at(1)));
+        }
+        if (args.size() > 2)
+        {
+            throw std::invalid_argument("too many arguments");
+        }
+        if (thread_count == 0)
+        {
+            throw std::invalid_argument("the thread count shall be positive");
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Invalid usage: " << ex.what() << std::endl;
+        return 1;
+    }
+    std::cerr << "Fuzzing for " << duration.count() << " s using " << thread_count << " threads" << std::endl;
+
+    std::random_device rnd_device;
+    if (!base_seed)
+    {
+        base_seed = (static_cast<std::uint64_t>(rnd_device()) << 32U) | rnd_device();
+    }
+    std::atomic<std::uint64_t> case_count{0};
+    std::atomic<bool>          failed{false};
+    const auto                 deadline = std::chrono::steady_clock::now() + duration;
+    std::vector<std::thread>   threads;
+    threads.reserve(thread_count);
+    for (std::uint32_t i = 0; i < thread_count; i++)
+    {
+        const auto seed = *base_seed + i;
+        std::cerr << "Seed for thread " << i << ": " << seed << std::endl;
+        threads.emplace_back(crc_fuzzer::worker, seed, deadline, std::ref(case_count), std::ref(failed));
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    std::cerr << "Cases tested: " << case_count.load() << std::endl;
+    if (failed || (case_count == 0))  // Nothing tested is not a pass.
+    {
+        std::cerr << "FAILED" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::uint8_t> buffer(1024U * 1024U);
+    std::mt19937              mersenne_engine{rnd_device()};
+    std::generate(buffer.begin(), buffer.end(), [&]() { return static_cast<std::uint8_t>(mersenne_engine()); });
+    std::apply([&](const auto&... e)
+               { (crc_fuzzer::benchmark<std::decay_t<decltype(e)>>(buffer, std::chrono::seconds(1)), ...); },
+               crc_fuzzer::Engines{});
+    return 0;
+}
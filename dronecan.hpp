@@ -0,0 +1,172 @@
+// Copyright (c) 2022  Zubax Robotics  <info@zubax.com>
+
+#pragma once
+
+#include "hash.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <linux/can.h>
+
+namespace dronecan
+{
+
+constexpr std::uint8_t TransferIDMax = 0x1FU;
+
+/// A single CAN 2.0 extended frame.
+struct Frame final
+{
+    std::uint32_t               can_id = 0;  ///< 29-bit identifier without flags.
+    std::uint8_t                dlc    = 0;
+    std::array<std::uint8_t, 8> data{};
+};
+
+/// Splits the serialized payload of a service request into CAN 2.0 frames per the DroneCAN transport layer
+/// specification. Multi-frame transfers are prepended with the transfer CRC, which is computed over the data type
+/// signature followed by the payload.
+inline std::vector<Frame> makeServiceRequestFrames(const std::uint8_t                priority,
+                                                   const std::uint8_t                service_type_id,
+                                                   const std::uint64_t               data_type_signature,
+                                                   const std::uint8_t                source_node_id,
+                                                   const std::uint8_t                destination_node_id,
+                                                   const std::uint8_t                transfer_id,
+                                                   const std::vector<std::uint8_t>& payload)
+{
+    constexpr std::size_t MaxFrameData  = 7U;  // One byte is reserved for the tail byte.
+    constexpr auto        TailSOT       = static_cast<std::uint8_t>(0x80U);
+    constexpr auto        TailEOT       = static_cast<std::uint8_t>(0x40U);
+    constexpr auto        TailToggle    = static_cast<std::uint8_t>(0x20U);
+    constexpr auto        NodeIDMax     = static_cast<std::uint8_t>(0x7FU);
+    if ((priority > 0x1FU) || (source_node_id == 0) || (source_node_id > NodeIDMax) ||
+        (destination_node_id == 0) || (destination_node_id > NodeIDMax) || (transfer_id > TransferIDMax))
+    {
+        throw std::invalid_argument("Invalid DroneCAN service transfer parameters");
+    }
+    constexpr std::uint32_t RequestNotResponse = 1U << 15U;
+    constexpr std::uint32_t ServiceNotMessage  = 1U << 7U;
+    const std::uint32_t     can_id             = (static_cast<std::uint32_t>(priority) << 24U) |
+                                 (static_cast<std::uint32_t>(service_type_id) << 16U) | RequestNotResponse |
+                                 (static_cast<std::uint32_t>(destination_node_id) << 8U) | ServiceNotMessage |
+                                 static_cast<std::uint32_t>(source_node_id);
+
+    std::vector<std::uint8_t> stream;
+    if (payload.size() > MaxFrameData)
+    {
+        hash::CRC16CCITT crc;
+        for (auto i = 0U; i < 8U; i++)  // The signature is fed little-endian.
+        {
+            const auto b = static_cast<std::uint8_t>(data_type_signature >> (i * 8U));
+            crc.update(&b, 1);
+        }
+        crc.update(payload.data(), payload.size());
+        const auto transfer_crc = crc.get();
+        stream.push_back(static_cast<std::uint8_t>(transfer_crc));  // The transfer CRC is little-endian on the wire.
+        stream.push_back(static_cast<std::uint8_t>(transfer_crc >> 8U));
+    }
+    stream.insert(stream.end(), payload.begin(), payload.end());
+
+    std::vector<Frame> out;
+    bool               toggle = false;
+    for (std::size_t offset = 0; (offset < stream.size()) || out.empty(); offset += MaxFrameData)
+    {
+        const auto size = std::min(MaxFrameData, stream.size() - offset);
+        Frame      fr;
+        fr.can_id = can_id;
+        fr.dlc    = static_cast<std::uint8_t>(size + 1U);
+        std::copy_n(stream.begin() + static_cast<std::ptrdiff_t>(offset), size, fr.data.begin());
+        const auto sot   = (offset == 0) ? TailSOT : 0U;
+        const auto eot   = ((offset + size) >= stream.size()) ? TailEOT : 0U;
+        fr.data.at(size) = static_cast<std::uint8_t>(sot | eot | (toggle ? TailToggle : 0U) | transfer_id);
+        toggle           = !toggle;
+        out.push_back(fr);
+    }
+    return out;
+}
+
+/// uavcan.protocol.file.BeginFirmwareUpdate
+namespace begin_firmware_update
+{
+constexpr std::uint8_t  ServiceTypeID     = 40U;
+constexpr std::uint64_t DataTypeSignature = 0xB7D7'25DF'7272'4126ULL;
+constexpr std::size_t   MaxPathLength     = 200U;
+constexpr std::uint8_t  DefaultPriority   = 16U;
+
+/// The path is the last field of the request, so per the tail array optimization rule it is serialized
+/// without the length prefix.
+inline std::vector<std::uint8_t> serializeRequest(const std::uint8_t               source_node_id,
+                                                  const std::vector<std::uint8_t>& path)
+{
+    if (path.size() > MaxPathLength)
+    {
+        throw std::length_error("The firmware file path is too long");
+    }
+    std::vector<std::uint8_t> out{source_node_id};
+    out.insert(out.end(), path.begin(), path.end());
+    return out;
+}
+}  // namespace begin_firmware_update
+
+/// Prints frames in the candump log format (candump -L), which can be replayed with canplayer.
+inline void printCandumpLog(std::ostream& os, const std::string& iface, const std::vector<Frame>& frames)
+{
+    const auto f = os.flags();
+    os << std::uppercase << std::hex;
+    for (const auto& fr : frames)
+    {
+        os << "(0000000000.000000) " << iface << ' ';
+        os.width(8);
+        os.fill('0');
+        os << fr.can_id << '#';
+        for (std::size_t i = 0; i < fr.dlc; i++)
+        {
+            os.width(2);
+            os << static_cast<std::uint16_t>(fr.data.at(i));
+        }
+        os << '\n';
+    }
+    os << std::flush;
+    os.flags(f);
+}
+
+/// Prints frames as SLCAN (LAWICEL) transmit commands for extended frames: Tiiiiiiiildd...<CR>.
+inline void printSLCAN(std::ostream& os, const std::vector<Frame>& frames)
+{
+    const auto f = os.flags();
+    os << std::uppercase << std::hex;
+    for (const auto& fr : frames)
+    {
+        os << 'T';
+        os.width(8);
+        os.fill('0');
+        os << fr.can_id << static_cast<std::uint16_t>(fr.dlc);
+        for (std::size_t i = 0; i < fr.dlc; i++)
+        {
+            os.width(2);
+            os << static_cast<std::uint16_t>(fr.data.at(i));
+        }
+        os << '\r';
+    }
+    os << std::flush;
+    os.flags(f);
+}
+
+/// Writes frames as a sequence of Linux SocketCAN `struct can_frame` suitable for writing into a raw CAN socket.
+inline void writeSocketCAN(std::ostream& os, const std::vector<Frame>& frames)
+{
+    for (const auto& fr : frames)
+    {
+        ::can_frame raw{};
+        raw.can_id = fr.can_id | CAN_EFF_FLAG;
+        raw.len    = fr.dlc;
+        std::copy_n(fr.data.begin(), fr.dlc, std::begin(raw.data));
+        os.write(reinterpret_cast<const char*>(&raw), sizeof(raw));
+    }
+    os << std::flush;
+}
+
+}  // namespace dronecan
@@ -0,0 +1,243 @@
+// Copyright (c) 2022  Zubax Robotics  <info@zubax.com>
+//
+// Scans raw memory dumps for valid LegacyV02 records at every byte offset. A record is reported if it is either
+// accepted by parseWithTrailingCRC() (this is how the bootloader sees it) or matches the output of
+// composeWithLeadingCRC() (this is how the application writes it). Usage:
+//
+//  ./dump_scanner [--threads N] FILE...
+
+#include "hash.hpp"
+#include "app_shared.hpp"
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dump_scanner
+{
+namespace
+{
+
+constexpr std::size_t Window     = sizeof(app_shared::LegacyV02);
+constexpr std::size_t CRCSize    = hash::CRC64WE::Size;
+constexpr std::size_t RecordSize = Window + CRCSize;
+constexpr std::size_t ChunkSize  = 64U * 1024U * 1024U;  ///< Window positions per work item.
+
+enum class Placement
+{
+    Trailing,  ///< CRC after the struct, as expected by parseWithTrailingCRC().
+    Leading,   ///< CRC before the struct, as produced by composeWithLeadingCRC().
+};
+
+struct Hit final
+{
+    std::size_t offset;  ///< Offset of the record (including the CRC) from the beginning of the file.
+    Placement   placement;
+};
+
+std::uint64_t loadCRC(const std::uint8_t* const ptr)
+{
+    std::uint64_t out{};
+    std::memcpy(&out, ptr, sizeof(out));  // The CRC is stored as a native integer in the shared struct wrapper.
+    return out;
+}
+
+/// Checks every window position in [begin, end). The window CRC is rolled so the cost per position is constant;
+/// each position is matched against the CRC stored right after the window and right before it.
+void scanChunk(const std::uint8_t* const data,
+               const std::size_t         size,
+               const std::size_t         begin,
+               const std::size_t         end,
+               std::vector<Hit>&         out)
+{
+    hash::RollingCRC64WE<Window> crc;
+    crc.reset(data + begin);
+    for (std::size_t p = begin; p < end; p++)
+    {
+        if (p > begin)
+        {
+            crc.roll(data[p - 1U], data[p + Window - 1U]);
+        }
+        const auto value = crc.get();
+        if (((p + RecordSize) <= size) && (value == loadCRC(data + p + Window)))
+        {
+            [[unlikely]] out.push_back({p, Placement::Trailing});
+        }
+        if ((p >= CRCSize) && (value == loadCRC(data + p - CRCSize)))
+        {
+            [[unlikely]] out.push_back({p - CRCSize, Placement::Leading});
+        }
+    }
+}
+
+std::vector<Hit> scan(const std::uint8_t* const data, const std::size_t size, const std::uint32_t thread_count)
+{
+    if (size < Window)
+    {
+        return {};
+    }
+    const auto                    positions   = size - Window + 1U;
+    const auto                    chunk_count = (positions + ChunkSize - 1U) / ChunkSize;
+    std::atomic<std::size_t>      next_chunk{0};
+    std::vector<std::vector<Hit>> hits(thread_count);
+    std::vector<std::thread>      threads;
+    threads.reserve(thread_count);
+    for (std::uint32_t i = 0; i < thread_count; i++)
+    {
+        threads.emplace_back(
+            [&, i]()
+            {
+                for (auto c = next_chunk++; c < chunk_count; c = next_chunk++)
+                {
+                    const auto begin = c * ChunkSize;
+                    scanChunk(data, size, begin, std::min(positions, begin + ChunkSize), hits.at(i));
+                }
+            });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    std::vector<Hit> out;
+    for (const auto& h : hits)
+    {
+        out.insert(out.end(), h.begin(), h.end());
+    }
+    std::sort(out.begin(), out.end(), [](const Hit& a, const Hit& b) { return a.offset < b.offset; });
+    return out;
+}
+
+/// Re-validates the hit using the same code as the application and the bootloader, then prints it.
+/// Returns false if the hit could not be confirmed, which would indicate a bug in the scanner.
+bool report(const std::uint8_t* const data, const Hit& hit)
+{
+    alignas(std::uint64_t) std::array<std::uint8_t, RecordSize> record{};
+    std::memcpy(record.data(), data + hit.offset, record.size());
+    std::optional<app_shared::LegacyV02> obj;
+    switch (hit.placement)
+    {
+    case Placement::Trailing:
+    {
+        obj = app_shared::parseWithTrailingCRC<app_shared::LegacyV02>(record.data());
+        break;
+    }
+    case Placement::Leading:
+    {
+        app_shared::LegacyV02 candidate{};
+        std::memcpy(&candidate, record.data() + CRCSize, sizeof(candidate));
+        if (app_shared::composeWithLeadingCRC(candidate) == record)
+        {
+            obj = candidate;
+        }
+        break;
+    }
+    }
+    std::cout << "0x" << std::hex << hit.offset << std::dec << ": "
+              << ((hit.placement == Placement::Trailing) ? "trailing" : "leading") << " CRC\n";
+    if (obj)
+    {
+        std::cout << *obj << std::endl;
+    }
+    return obj.has_value();
+}
+
+}  // namespace
+}  // namespace dump_scanner
+
+int main(const int argc, const char* const argv[])
+{
+    std::vector<std::string> files;
+    auto                     thread_count = std::max(1U, std::thread::hardware_concurrency());
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string a(argv[i]);
+            if (a == "--threads")
+            {
+                if (++i >= argc)
+                {
+                    throw std::invalid_argument("--threads requires a value");
+                }
+                thread_count = static_cast<std::uint32_t>(std::stoul(argv[i]));
+            }
+            else
+            {
+                files.push_back(a);
+            }
+        }
+        if (thread_count == 0)
+        {
+            throw std::invalid_argument("the thread count shall be positive");
+        }
+        if (files.empty())
+        {
+            throw std::invalid_argument("expected one or more file names");
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Invalid usage: " << ex.what() << std::endl;
+        return 1;
+    }
+    int result = 0;
+    for (const auto& name : files)
+    {
+        const int fd = ::open(name.c_str(), O_RDONLY);
+        struct stat st{};
+        if ((fd < 0) || (::fstat(fd, &st) != 0))
+        {
+            std::cerr << name << ": " << std::strerror(errno) << std::endl;
+            if (fd >= 0)
+            {
+                (void) ::close(fd);
+            }
+            result = 1;
+            continue;
+        }
+        const auto size = static_cast<std::size_t>(st.st_size);
+        void*      map  = (size > 0) ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+        (void) ::close(fd);
+        if (map == MAP_FAILED)
+        {
+            std::cerr << name << ": " << std::strerror(errno) << std::endl;
+            result = 1;
+            continue;
+        }
+        if (map != nullptr)
+        {
+            (void) ::madvise(map, size, MADV_SEQUENTIAL);
+        }
+        const auto* const data       = static_cast<const std::uint8_t*>(map);
+        const auto        started_at = std::chrono::steady_clock::now();
+        const auto        hits       = dump_scanner::scan(data, size, thread_count);
+        const auto        elapsed    = std::chrono::steady_clock::now() - started_at;
+        std::cout << name << ": " << hits.size() << " records\n";
+        for (const auto& h : hits)
+        {
+            if (!dump_scanner::report(data, h))
+            {
+                std::cerr << "Could not confirm the record; this is a bug" << std::endl;
+                result = 1;
+            }
+        }
+        const auto seconds = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed).count();
+        std::cerr << name << ": scanned " << (static_cast<double>(size) * 1e-6) << " MB in " << seconds << " s ("
+                  << ((static_cast<double>(size) * 1e-6) / seconds) << " MB/s)" << std::endl;
+        if (map != nullptr)
+        {
+            (void) ::munmap(map, size);
+        }
+    }
+    return result;
+}
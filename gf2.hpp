@@ -0,0 +1,323 @@
+// Copyright (c) 2022  Zubax Robotics  <info@zubax.com>
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace gf2
+{
+
+/// Dense bit-packed matrix over GF(2). Bit j of a row is stored in word j/64 at bit position j%64.
+/// Each row is padded to a whole number of cache lines so that rows never share a line, which keeps the row
+/// operations vectorizable and allows different threads to update different rows without false sharing.
+class Matrix final
+{
+public:
+    using Word                                  = std::uint64_t;
+    static constexpr std::size_t WordBits       = 64U;
+    static constexpr std::size_t CacheLineBytes = 64U;
+
+    Matrix(const std::size_t rows, const std::size_t cols) :
+        rows_(rows), cols_(cols), stride_(computeStride(cols)), storage_(allocate(rows_ * stride_))
+    {}
+
+    Matrix(const Matrix& other) : Matrix(other.rows_, other.cols_)
+    {
+        std::memcpy(storage_.get(), other.storage_.get(), rows_ * stride_ * sizeof(Word));
+    }
+    Matrix(Matrix&&) noexcept = default;
+    Matrix& operator=(const Matrix& other)
+    {
+        if (this != &other)
+        {
+            *this = Matrix(other);
+        }
+        return *this;
+    }
+    Matrix& operator=(Matrix&&) noexcept = default;
+    ~Matrix()                            = default;
+
+    [[nodiscard]] std::size_t rows() const { return rows_; }
+    [[nodiscard]] std::size_t cols() const { return cols_; }
+    /// The number of words per row including the padding.
+    [[nodiscard]] std::size_t stride() const { return stride_; }
+
+    [[nodiscard]] Word*       row(const std::size_t r) { return storage_.get() + (r * stride_); }
+    [[nodiscard]] const Word* row(const std::size_t r) const { return storage_.get() + (r * stride_); }
+
+    [[nodiscard]] bool get(const std::size_t r, const std::size_t c) const
+    {
+        return ((row(r)[c / WordBits] >> (c % WordBits)) & 1U) != 0;
+    }
+    void set(const std::size_t r, const std::size_t c, const bool value)
+    {
+        const auto mask = static_cast<Word>(1) << (c % WordBits);
+        auto&      w    = row(r)[c / WordBits];
+        w               = value ? (w | mask) : (w & ~mask);
+    }
+    void flip(const std::size_t r, const std::size_t c)
+    {
+        row(r)[c / WordBits] ^= static_cast<Word>(1) << (c % WordBits);
+    }
+
+    /// Reads `width` (at most 64) consecutive bits of a row starting from the specified column.
+    [[nodiscard]] Word getBits(const std::size_t r, const std::size_t c, const std::size_t width) const
+    {
+        const auto* const words = row(r);
+        const auto        shift = c % WordBits;
+        auto              out   = words[c / WordBits] >> shift;
+        if ((shift > 0) && ((shift + width) > WordBits))
+        {
+            out |= words[(c / WordBits) + 1U] << (WordBits - shift);
+        }
+        return (width < WordBits) ? (out & ((static_cast<Word>(1) << width) - 1U)) : out;
+    }
+
+    void swapRows(const std::size_t a, const std::size_t b)
+    {
+        if (a != b)
+        {
+            std::swap_ranges(row(a), row(a) + stride_, row(b));
+        }
+    }
+
+    /// dst ^= src, where src may belong to another matrix of the same width.
+    /// Words below `first_word` are assumed to be zero in src and are skipped.
+    void xorRow(const std::size_t dst, const Word* const src, const std::size_t first_word = 0)
+    {
+        auto* const d = row(dst);
+        for (std::size_t i = first_word; i < stride_; i++)
+        {
+            d[i] ^= src[i];
+        }
+    }
+
+private:
+    struct Deleter final
+    {
+        void operator()(Word* const p) const { ::operator delete[](p, std::align_val_t{CacheLineBytes}); }
+    };
+
+    static std::size_t computeStride(const std::size_t cols)
+    {
+        constexpr auto WordsPerLine = CacheLineBytes / sizeof(Word);
+        const auto     words        = (cols + WordBits - 1U) / WordBits;
+        return std::max<std::size_t>(1U, (words + WordsPerLine - 1U) / WordsPerLine) * WordsPerLine;
+    }
+
+    static std::unique_ptr<Word[], Deleter> allocate(const std::size_t words)
+    {
+        auto* const p = static_cast<Word*>(::operator new[](std::max<std::size_t>(1U, words) * sizeof(Word),
+                                                            std::align_val_t{CacheLineBytes}));
+        std::fill(p, p + words, 0);
+        return std::unique_ptr<Word[], Deleter>(p);
+    }
+
+    std::size_t                      rows_;
+    std::size_t                      cols_;
+    std::size_t                      stride_;
+    std::unique_ptr<Word[], Deleter> storage_;
+};
+
+namespace detail
+{
+/// Below this many matrix words per block update the thread spawning overhead exceeds the gains.
+constexpr std::size_t MinWordsPerThread = 64U * 1024U;
+
+/// Invokes fn(begin, end) over [0, count) split into contiguous ranges processed in parallel.
+template <typename F>
+void parallelFor(const std::size_t count, const std::size_t work_per_item, const std::size_t thread_count, F&& fn)
+{
+    const auto n = std::min(thread_count, std::max<std::size_t>(1U, (count * work_per_item) / MinWordsPerThread));
+    if (n <= 1U)
+    {
+        fn(std::size_t{0}, count);
+        return;
+    }
+    std::vector<std::thread> threads;
+    threads.reserve(n - 1U);
+    const auto chunk = (count + n - 1U) / n;
+    for (std::size_t i = 1; i < n; i++)
+    {
+        const auto begin = std::min(count, i * chunk);
+        const auto end   = std::min(count, begin + chunk);
+        threads.emplace_back([&fn, begin, end]() { fn(begin, end); });
+    }
+    fn(std::size_t{0}, std::min(count, chunk));
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+}
+
+/// The Four Russians block size is chosen such that the table of 2^k row combinations is amortized over the rows.
+inline std::size_t chooseBlockSize(const std::size_t rows)
+{
+    return std::clamp<std::size_t>((static_cast<std::size_t>(std::bit_width(rows)) * 3U) / 4U, 1U, 8U);
+}
+}  // namespace detail
+
+/// Reduces the first `cols_to_reduce` columns of the matrix to the reduced row echelon form in place using the
+/// Method of the Four Russians; the remaining columns (e.g., the augmented part) are carried along.
+/// Columns are processed in blocks of k: up to k pivots are found by plain elimination within the block,
+/// then a table of all 2^k combinations of the pivot rows is built and every other row is cleared with
+/// a single table lookup per block instead of up to k row additions.
+/// The row updates of each block are optionally distributed across threads.
+/// Returns the pivot columns in the order of the pivot rows; the rank is the size of the result.
+inline std::vector<std::size_t> reduce(Matrix& m, const std::size_t cols_to_reduce, const std::size_t thread_count = 1)
+{
+    const auto               k = detail::chooseBlockSize(m.rows());
+    std::vector<std::size_t> pivots;
+    Matrix                   table(std::size_t{1} << k, m.cols());
+    std::size_t              r = 0;
+    for (std::size_t c = 0; (c < cols_to_reduce) && (r < m.rows()); c += k)
+    {
+        const auto width      = std::min(k, cols_to_reduce - c);
+        const auto first_word = c / Matrix::WordBits;
+        // Find up to `width` pivots within the block, keeping the block's pivot rows mutually reduced.
+        std::vector<std::size_t> block_pivots;  // Column offsets within the block.
+        for (std::size_t j = 0; (j < width) && ((r + block_pivots.size()) < m.rows()); j++)
+        {
+            const auto p     = r + block_pivots.size();
+            auto       found = m.rows();
+            for (std::size_t i = p; i < m.rows(); i++)
+            {
+                for (std::size_t q = 0; q < block_pivots.size(); q++)
+                {
+                    if (m.get(i, c + block_pivots[q]))
+                    {
+                        m.xorRow(i, m.row(r + q), first_word);
+                    }
+                }
+                if (m.get(i, c + j))
+                {
+                    found = i;
+                    break;
+                }
+            }
+            if (found < m.rows())
+            {
+                m.swapRows(p, found);
+                for (std::size_t q = 0; q < block_pivots.size(); q++)
+                {
+                    if (m.get(r + q, c + j))
+                    {
+                        m.xorRow(r + q, m.row(p), first_word);
+                    }
+                }
+                block_pivots.push_back(j);
+            }
+        }
+        if (block_pivots.empty())
+        {
+            continue;
+        }
+        // table[w] is the combination of the pivot rows that clears the pivot bits set in the block window w.
+        // The bits of w at non-pivot columns are ignored; those columns are zero below the pivot rows anyway.
+        Matrix::Word pivot_mask = 0;
+        for (const auto j : block_pivots)
+        {
+            pivot_mask |= static_cast<Matrix::Word>(1) << j;
+        }
+        const auto table_size = static_cast<std::size_t>(1) << width;
+        for (std::size_t w = 1; w < table_size; w++)
+        {
+            std::memset(table.row(w), 0, table.stride() * sizeof(Matrix::Word));
+            const auto pw = w & pivot_mask;
+            if (pw != 0)
+            {
+                const auto low = static_cast<std::size_t>(std::countr_zero(pw));
+                const auto idx = static_cast<std::size_t>(
+                    std::find(block_pivots.begin(), block_pivots.end(), low) - block_pivots.begin());
+                table.xorRow(w, table.row(w & ~(static_cast<std::size_t>(1) << low)), first_word);
+                table.xorRow(w, m.row(r + idx), first_word);
+            }
+        }
+        const auto block_end = r + block_pivots.size();
+        detail::parallelFor(m.rows(),
+                            m.stride() - first_word,
+                            thread_count,
+                            [&](const std::size_t begin, const std::size_t end)
+                            {
+                                for (std::size_t i = begin; i < end; i++)
+                                {
+                                    if ((i < r) || (i >= block_end))
+                                    {
+                                        const auto w = m.getBits(i, c, width) & pivot_mask;
+                                        if (w != 0)
+                                        {
+                                            m.xorRow(i, table.row(w), first_word);
+                                        }
+                                    }
+                                }
+                            });
+        for (const auto j : block_pivots)
+        {
+            pivots.push_back(c + j);
+        }
+        r = block_end;
+    }
+    return pivots;
+}
+
+/// The complete solution set of a linear system: x ^ span(null_space).
+struct Solution final
+{
+    Matrix x;           ///< A particular solution with all free variables set to zero; 1 row.
+    Matrix null_space;  ///< The basis of the null space of A, one vector per row; the rows are the degrees of freedom.
+};
+
+/// Solves Ax = b over GF(2), where `a` has one row per equation and one column per variable, and `b` is a column
+/// with one row per equation. Returns empty if the system is inconsistent.
+inline std::optional<Solution> solve(const Matrix& a, const Matrix& b, const std::size_t thread_count = 1)
+{
+    const auto n = a.cols();
+    Matrix     aug(a.rows(), n + 1U);
+    for (std::size_t i = 0; i < a.rows(); i++)
+    {
+        std::copy(a.row(i), a.row(i) + a.stride(), aug.row(i));
+        aug.set(i, n, b.get(i, 0));
+    }
+    const auto pivots = reduce(aug, n, thread_count);
+    for (std::size_t i = pivots.size(); i < aug.rows(); i++)
+    {
+        if (aug.get(i, n))
+        {
+            return {};
+        }
+    }
+    Solution out{Matrix(1, n), Matrix(n - pivots.size(), n)};
+    for (std::size_t i = 0; i < pivots.size(); i++)
+    {
+        out.x.set(0, pivots[i], aug.get(i, n));
+    }
+    std::vector<bool> is_pivot(n, false);
+    for (const auto p : pivots)
+    {
+        is_pivot[p] = true;
+    }
+    std::size_t basis_index = 0;
+    for (std::size_t f = 0; f < n; f++)
+    {
+        if (!is_pivot[f])
+        {
+            out.null_space.set(basis_index, f, true);
+            for (std::size_t i = 0; i < pivots.size(); i++)
+            {
+                out.null_space.set(basis_index, pivots[i], aug.get(i, f));
+            }
+            basis_index++;
+        }
+    }
+    return out;
+}
+
+}  // namespace gf2
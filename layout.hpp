@@ -0,0 +1,228 @@
+// Copyright (c) 2022  Zubax Robotics  <info@zubax.com>
+
+#pragma once
+
+#include "hash.hpp"
+#include "app_shared.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/// Compile-time descriptions of the shared struct generations and of how they are written and read.
+/// The application of one generation may hand over to the bootloader of another, so the forging target is a View:
+/// a pair of a writer layout and a reader layout sharing the same memory.
+/// Everything here is constexpr so that the solver can be specialized for each combination at compile time.
+namespace layout
+{
+
+static_assert(std::endian::native == std::endian::little, "The shared struct wrapper stores the CRC natively");
+
+template <std::size_t N>
+using Bytes = std::array<std::uint8_t, N>;
+
+/// The layout-independent content of the update request.
+struct Request final
+{
+    static constexpr std::size_t MaxFileNameSize = 201U;
+
+    std::uint32_t                     can_bus_speed            = 0;
+    std::uint8_t                      uavcan_node_id           = 0;
+    std::uint8_t                      uavcan_fw_server_node_id = 0;
+    std::array<char, MaxFileNameSize> uavcan_file_name{};
+    bool                              stay_in_bootloader = true;
+
+    /// Bit i of the file name, counting from the LSB of the first byte.
+    constexpr void flipFileNameBit(const std::size_t index)
+    {
+        auto& c = uavcan_file_name.at(index / CHAR_BIT);
+        c       = static_cast<char>(static_cast<std::uint8_t>(c) ^ (1U << (index % CHAR_BIT)));
+    }
+};
+
+/// Same format as the printer of the shared structs in app_shared.hpp.
+inline std::ostream& operator<<(std::ostream& os, const Request& req)
+{
+    const auto f = os.flags();
+    os << std::boolalpha;
+    os << "can_bus_speed: " << req.can_bus_speed << '\n';
+    os << "uavcan_node_id: " << static_cast<std::int64_t>(req.uavcan_node_id) << '\n';
+    os << "uavcan_fw_server_node_id: " << static_cast<std::int64_t>(req.uavcan_fw_server_node_id) << '\n';
+    os << "uavcan_file_name: {" << std::hex;
+    for (const auto c : req.uavcan_file_name)
+    {
+        os.width(2);
+        os.fill('0');
+        os << (static_cast<std::uint16_t>(c) & 0xFFU) << ',';
+    }
+    os << "}\n";
+    os << "stay_in_bootloader: " << req.stay_in_bootloader << '\n';
+    os << std::flush;
+    os.flags(f);
+    return os;
+}
+
+struct Field final
+{
+    std::size_t offset;
+    std::size_t size;
+};
+
+/// Specialize this for every shared struct generation; the offsets should be obtained via offsetof.
+template <typename Container>
+struct Fields;
+
+template <>
+struct Fields<app_shared::LegacyV02>
+{
+    using C = app_shared::LegacyV02;
+
+    static constexpr Field CANBusSpeed          = {offsetof(C, can_bus_speed), sizeof(C::can_bus_speed)};
+    static constexpr Field UAVCANNodeID         = {offsetof(C, uavcan_node_id), sizeof(C::uavcan_node_id)};
+    static constexpr Field UAVCANFWServerNodeID = {offsetof(C, uavcan_fw_server_node_id),
+                                                   sizeof(C::uavcan_fw_server_node_id)};
+    static constexpr Field UAVCANFileName       = {offsetof(C, uavcan_file_name), sizeof(C::uavcan_file_name)};
+    static constexpr Field StayInBootloader     = {offsetof(C, stay_in_bootloader), sizeof(C::stay_in_bootloader)};
+};
+
+/// CRC placement policy: the CRC is stored before the container, as done by composeWithLeadingCRC().
+struct LeadingCRC final
+{
+    static constexpr std::size_t ContainerOffset = hash::CRC64WE::Size;
+
+    template <std::size_t N>
+    static constexpr Bytes<N + hash::CRC64WE::Size> compose(const Bytes<N>& container)
+    {
+        Bytes<N + hash::CRC64WE::Size> out{};
+        storeCRC(out.data(), computeCRC(container.data(), N));
+        std::copy(container.begin(), container.end(), out.begin() + hash::CRC64WE::Size);
+        return out;
+    }
+
+    /// Zero if the reader accepts the container, otherwise the difference between the computed and stored CRC.
+    template <std::size_t N>
+    static constexpr std::uint64_t residual(const Bytes<N + hash::CRC64WE::Size>& image)
+    {
+        return computeCRC(image.data() + hash::CRC64WE::Size, N) ^ loadCRC(image.data());
+    }
+
+    static constexpr std::uint64_t computeCRC(const std::uint8_t* const data, const std::size_t size)
+    {
+        hash::CRC64WE crc;
+        crc.update(data, size);
+        return crc.get();
+    }
+    static constexpr void storeCRC(std::uint8_t* const out, std::uint64_t value)
+    {
+        for (std::size_t i = 0; i < hash::CRC64WE::Size; i++)
+        {
+            out[i] = static_cast<std::uint8_t>(value);
+            value >>= 8U;
+        }
+    }
+    static constexpr std::uint64_t loadCRC(const std::uint8_t* const in)
+    {
+        std::uint64_t out = 0;
+        for (std::size_t i = 0; i < hash::CRC64WE::Size; i++)
+        {
+            out |= static_cast<std::uint64_t>(in[i]) << (i * 8U);
+        }
+        return out;
+    }
+};
+
+/// CRC placement policy: the CRC is stored after the container, as expected by parseWithTrailingCRC().
+struct TrailingCRC final
+{
+    static constexpr std::size_t ContainerOffset = 0;
+
+    template <std::size_t N>
+    static constexpr Bytes<N + hash::CRC64WE::Size> compose(const Bytes<N>& container)
+    {
+        Bytes<N + hash::CRC64WE::Size> out{};
+        std::copy(container.begin(), container.end(), out.begin());
+        LeadingCRC::storeCRC(out.data() + N, LeadingCRC::computeCRC(container.data(), N));
+        return out;
+    }
+
+    template <std::size_t N>
+    static constexpr std::uint64_t residual(const Bytes<N + hash::CRC64WE::Size>& image)
+    {
+        return LeadingCRC::computeCRC(image.data(), N) ^ LeadingCRC::loadCRC(image.data() + N);
+    }
+};
+
+template <typename Container, typename CRCPlacement>
+struct Layout final
+{
+    using Type      = Container;
+    using Placement = CRCPlacement;
+
+    static constexpr std::size_t Size      = sizeof(Container);
+    static constexpr std::size_t ImageSize = Size + hash::CRC64WE::Size;
+
+    static constexpr Field FileName = Fields<Container>::UAVCANFileName;
+
+    /// Offset of the file name from the beginning of the image.
+    static constexpr std::size_t ImageFileNameOffset = Placement::ContainerOffset + FileName.offset;
+
+    /// The container as the application fills it in. Fields not covered by the request are zero.
+    static constexpr Bytes<Size> serialize(const Request& req)
+    {
+        using F = Fields<Container>;
+        Bytes<Size> out{};
+        put(out, F::CANBusSpeed, req.can_bus_speed);
+        put(out, F::UAVCANNodeID, req.uavcan_node_id);
+        put(out, F::UAVCANFWServerNodeID, req.uavcan_fw_server_node_id);
+        put(out, F::StayInBootloader, req.stay_in_bootloader ? 1U : 0U);
+        for (std::size_t i = 0; i < std::min(F::UAVCANFileName.size, Request::MaxFileNameSize); i++)
+        {
+            out.at(F::UAVCANFileName.offset + i) = static_cast<std::uint8_t>(req.uavcan_file_name.at(i));
+        }
+        return out;
+    }
+
+    /// The memory image of the shared region as written by the application of this generation.
+    static constexpr Bytes<ImageSize> write(const Request& req) { return Placement::compose(serialize(req)); }
+
+    /// The reader's view of an image written by another layout; the bytes beyond the image read as zero.
+    template <std::size_t M>
+    static constexpr std::uint64_t residual(const Bytes<M>& image)
+    {
+        Bytes<ImageSize> view{};
+        std::copy(image.begin(), image.begin() + std::min(M, ImageSize), view.begin());
+        return Placement::template residual<Size>(view);
+    }
+
+private:
+    static constexpr void put(Bytes<Size>& out, const Field& field, std::uint64_t value)
+    {
+        for (std::size_t i = 0; i < field.size; i++)
+        {
+            out.at(field.offset + i) = static_cast<std::uint8_t>(value);
+            value >>= 8U;
+        }
+    }
+};
+
+/// The request is written by the application using Writer and read back by the bootloader using Reader.
+template <typename Writer, typename Reader>
+struct View final
+{
+    using WriterLayout = Writer;
+    using ReaderLayout = Reader;
+
+    /// Zero iff the bootloader accepts the request. The function is affine in the request bits.
+    static constexpr std::uint64_t residual(const Request& req) { return Reader::residual(Writer::write(req)); }
+};
+
+/// The legacy v0.x application writes the struct with the CRC in front, while the bootloader v1.1 expects it
+/// at the end; this mismatch is the reason this tool exists.
+using LegacyV02Application = Layout<app_shared::LegacyV02, LeadingCRC>;
+using LegacyV02Bootloader  = Layout<app_shared::LegacyV02, TrailingCRC>;
+using LegacyV02View        = View<LegacyV02Application, LegacyV02Bootloader>;
+
+}  // namespace layout
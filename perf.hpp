@@ -0,0 +1,205 @@
+// Copyright (c) 2022  Zubax Robotics  <info@zubax.com>
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#    include <x86intrin.h>
+#endif
+
+/// Set to 1 to instrument the hot paths with hardware performance counters; see CMake option PERF_COUNTERS.
+#ifndef PERF_COUNTERS
+#    define PERF_COUNTERS 0
+#endif
+
+namespace perf
+{
+
+/// Raw counter snapshot. Deltas between two snapshots are obtained via subtraction.
+/// The enabled and running times are used to detect PMU multiplexing; they are zero if the TSC is used.
+struct Sample final
+{
+    std::uint64_t cycles       = 0;
+    std::uint64_t instructions = 0;
+    std::uint64_t l1d_misses   = 0;
+    std::uint64_t time_enabled = 0;  ///< [nanosecond]
+    std::uint64_t time_running = 0;  ///< [nanosecond]
+};
+
+inline Sample operator-(const Sample& a, const Sample& b)
+{
+    return {
+        .cycles       = a.cycles - b.cycles,
+        .instructions = a.instructions - b.instructions,
+        .l1d_misses   = a.l1d_misses - b.l1d_misses,
+        .time_enabled = a.time_enabled - b.time_enabled,
+        .time_running = a.time_running - b.time_running,
+    };
+}
+
+/// Per-thread hardware counters based on perf_event_open(2). The counters only observe the thread that constructed
+/// the instance, so each worker thread shall have its own instance.
+/// If the kernel refuses to provide the counters (no PMU in a VM, perf_event_paranoid, seccomp, etc.),
+/// the instance degrades gracefully to the time stamp counter: cycles are then TSC ticks (which do not follow the
+/// core frequency), while the instruction and L1D miss counts are unavailable.
+class Counters final
+{
+public:
+    Counters()
+    {
+        const auto l1d_read_miss = static_cast<std::uint64_t>(PERF_COUNT_HW_CACHE_L1D) |
+                                   (static_cast<std::uint64_t>(PERF_COUNT_HW_CACHE_OP_READ) << 8U) |
+                                   (static_cast<std::uint64_t>(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16U);
+        fds_.at(Cycles) = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+        if (fds_.at(Cycles) >= 0)
+        {
+            fds_.at(Instructions) = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, fds_.at(Cycles));
+            fds_.at(L1DMisses)    = open(PERF_TYPE_HW_CACHE, l1d_read_miss, fds_.at(Cycles));
+            (void) ::ioctl(fds_.at(Cycles), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            (void) ::ioctl(fds_.at(Cycles), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    ~Counters()
+    {
+        for (const auto fd : fds_)
+        {
+            if (fd >= 0)
+            {
+                (void) ::close(fd);
+            }
+        }
+    }
+
+    Counters(const Counters&)            = delete;
+    Counters(Counters&&)                 = delete;
+    Counters& operator=(const Counters&) = delete;
+    Counters& operator=(Counters&&)      = delete;
+
+    /// True if the real PMU counters are in use; false if we fell back to the TSC.
+    [[nodiscard]] bool isPrecise() const { return fds_.at(Cycles) >= 0; }
+    [[nodiscard]] bool hasInstructions() const { return fds_.at(Instructions) >= 0; }
+    [[nodiscard]] bool hasL1DMisses() const { return fds_.at(L1DMisses) >= 0; }
+
+    [[nodiscard]] Sample read() const
+    {
+        Sample out{};
+        if (isPrecise())
+        {
+            // With PERF_FORMAT_GROUP and the total times the layout is {nr, time_enabled, time_running, values[nr]},
+            // the values being in the order the events were added to the group.
+            std::array<std::uint64_t, 3U + NumEvents> buf{};
+            if (::read(fds_.at(Cycles), buf.data(), sizeof(buf)) > 0)
+            {
+                out.time_enabled = buf.at(1);
+                out.time_running = buf.at(2);
+                std::size_t idx  = 3;
+                out.cycles       = buf.at(idx++);
+                if (hasInstructions())
+                {
+                    out.instructions = buf.at(idx++);
+                }
+                if (hasL1DMisses())
+                {
+                    out.l1d_misses = buf.at(idx++);
+                }
+            }
+        }
+        else
+        {
+            out.cycles = readTimestamp();
+        }
+        return out;
+    }
+
+    /// Prints cycles per unit, IPC, and L1D misses per unit for the given delta; unavailable metrics are marked n/a.
+    /// If the PMU was multiplexed with other events, the counts are scaled by the ratio of the enabled time to the
+    /// running time, which is noted in the output; if the group was not scheduled at all, all metrics are n/a.
+    void report(std::ostream& os, const Sample& delta, const double units, const char* const unit_name) const
+    {
+        const bool scheduled   = !isPrecise() || (delta.time_running > 0);
+        const bool multiplexed = isPrecise() && (delta.time_running < delta.time_enabled);
+        auto       scale       = 1.0;
+        if (multiplexed && scheduled)
+        {
+            scale = static_cast<double>(delta.time_enabled) / static_cast<double>(delta.time_running);
+        }
+        const auto cycles = static_cast<double>(delta.cycles) * scale;
+        os << (isPrecise() ? "cycles/" : "TSC ticks/") << unit_name << ' ';
+        if (scheduled)
+        {
+            os << (cycles / units);
+        }
+        else
+        {
+            os << "n/a";
+        }
+        os << "; IPC ";
+        if (scheduled && hasInstructions() && (delta.cycles > 0))
+        {
+            os << (static_cast<double>(delta.instructions) / static_cast<double>(delta.cycles));
+        }
+        else
+        {
+            os << "n/a";
+        }
+        os << "; L1D misses/" << unit_name << ' ';
+        if (scheduled && hasL1DMisses())
+        {
+            os << ((static_cast<double>(delta.l1d_misses) * scale) / units);
+        }
+        else
+        {
+            os << "n/a";
+        }
+        if (multiplexed)
+        {
+            os << " (PMU multiplexed, counted "
+               << ((static_cast<double>(delta.time_running) * 100.0) / static_cast<double>(delta.time_enabled))
+               << "% of the time" << (scheduled ? ", scaled)" : ")");
+        }
+    }
+
+private:
+    static constexpr std::size_t Cycles       = 0;
+    static constexpr std::size_t Instructions = 1;
+    static constexpr std::size_t L1DMisses    = 2;
+    static constexpr std::size_t NumEvents    = 3;
+
+    static int open(const std::uint32_t type, const std::uint64_t config, const int group_fd)
+    {
+        ::perf_event_attr attr{};
+        attr.size           = sizeof(attr);
+        attr.type           = type;
+        attr.config         = config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        if (group_fd < 0)
+        {
+            attr.disabled = 1;  // The group leader is enabled explicitly once all members are attached.
+        }
+        // pid=0, cpu=-1: follow the calling thread on any CPU.
+        return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0UL));
+    }
+
+    static std::uint64_t readTimestamp()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    std::array<int, NumEvents> fds_{-1, -1, -1};
+};
+
+}  // namespace perf
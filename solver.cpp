@@ -1,63 +1,217 @@
 // Copyright (c) 2022  Zubax Robotics  <info@zubax.com>
 
 #include "app_shared.hpp"
-#include "forge.h"
+#include "baked.hpp"
+#include "dronecan.hpp"
+#include "gf2.hpp"
+#include "layout.hpp"
+#include "perf.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <vector>
-#include <concepts>
 #include <climits>
-#include <numeric>
+#include <functional>
+#include <random>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 
 namespace solver
 {
 namespace
 {
-app_shared::LegacyV02 g_obj;
+/// The request has to be accepted under every view listed here. To forge a request that also survives a hand-over
+/// between other generations, describe their layouts in layout.hpp and add the views; the elimination is
+/// specialized for the combination at compile time.
+using Solver = baked::Solver<layout::LegacyV02View>;
 
-template <typename>
-[[maybe_unused]] inline constexpr bool DependentFalsity = false;
+/// The layout that the output image is written in.
+using Writer = layout::LegacyV02Application;
 
-constexpr std::size_t NameOffsetBytes = 14U;
+layout::Request g_req;
 
-template <std::integral T>
-::bigint makeBigInt(const T& value)
+/// The residual R is affine in the flipped bits: R(m ^ x) = R(m) ^ Ax, so the system to solve for the zero target
+/// is Ax = R(m). Column j of A is the effect of flipping name bit j; row i corresponds to bit i of the stacked
+/// residuals. Every bit of the file name is offered to the general solver to report the degrees of freedom.
+std::pair<gf2::Matrix, gf2::Matrix> buildSystem(const layout::Request& req)
 {
-    ::bigint res{};
-    (void) bigint_init(&res, sizeof(T) * CHAR_BIT);
-    if constexpr (sizeof(T) <= sizeof(::limb_t))
+    gf2::Matrix a(Solver::EquationCount, Solver::FileNameBits);
+    gf2::Matrix b(Solver::EquationCount, 1);
+    const auto  base = Solver::residual(req);
+    for (std::size_t i = 0; i < Solver::EquationCount; i++)
     {
-        res.limb[0] = value;
+        b.set(i, 0, base.get(i));
     }
-    else if constexpr (sizeof(T) == (sizeof(::limb_t) * 2))
+    for (std::size_t j = 0; j < Solver::FileNameBits; j++)
     {
-        res.limb[0] = value & std::numeric_limits<::limb_t>::max();
-        res.limb[1] = (value >> (sizeof(::limb_t) * CHAR_BIT)) & std::numeric_limits<::limb_t>::max();
+        auto mod = req;
+        mod.flipFileNameBit(j);
+        auto column = Solver::residual(mod);
+        column ^= base;
+        for (std::size_t i = 0; i < Solver::EquationCount; i++)
+        {
+            a.set(i, j, column.get(i));
+        }
     }
-    else
+    return {std::move(a), std::move(b)};
+}
+
+void testCRC16CCITT()
+{
+    hash::CRC16CCITT crc;
+    const char*      val = "123456789";
+    crc.update(reinterpret_cast<const std::uint8_t*>(val), 9);
+    if ((crc.get() != 0x29B1U) || (crc.getBytes().at(0) != 0x29U) || (crc.getBytes().at(1) != 0xB1U))
+    {
+        std::abort();
+    }
+    crc.update(crc.getBytes().data(), crc.getBytes().size());
+    if (!crc.isResidueCorrect())
     {
-        static_assert(DependentFalsity<T>, "Unsupported type");
+        std::abort();
     }
-    return res;
 }
 
-void forgeH(const std::size_t flip_bit_index, ::bigint* const out_hash) noexcept
+/// Row i of the result is bit i of A·v, where v is the row of a matrix as wide as A.
+gf2::Matrix multiply(const gf2::Matrix& a, const gf2::Matrix::Word* const v)
 {
-    auto obj = g_obj;
-    if (flip_bit_index < sizeof(app_shared::LegacyV02) * CHAR_BIT)
-    {
-        // const auto pos = (flip_bit_index & ~7U) | (7U - (flip_bit_index & 7U)); // if CRC is reflected
-        const auto pos         = flip_bit_index;
-        const auto pos_in_name = pos - (NameOffsetBytes + hash::CRC64WE::Size) * CHAR_BIT;
-        *reinterpret_cast<std::uint8_t*>(obj.uavcan_file_name.data() + (pos_in_name / CHAR_BIT)) ^=
-            (1U << (pos_in_name % CHAR_BIT));
+    gf2::Matrix out(a.rows(), 1);
+    for (std::size_t i = 0; i < a.rows(); i++)
+    {
+        std::size_t ones = 0;
+        for (std::size_t w = 0; w < a.stride(); w++)
+        {
+            ones += static_cast<std::size_t>(std::popcount(a.row(i)[w] & v[w]));
+        }
+        out.set(i, 0, (ones % 2U) != 0);
+    }
+    return out;
+}
+
+/// The general solver is not covered by the compile-time checks of the baked one, so it is verified on random
+/// consistent systems with dependent columns: A·x = b, and A·n = 0 for every row n of the null space basis.
+/// The last system is large enough for the row updates to be distributed across threads.
+void testGF2()
+{
+    struct Shape final
+    {
+        std::size_t rows;
+        std::size_t cols;
+        std::size_t dependent_cols;
+        std::size_t thread_count;
+    };
+    constexpr std::array<Shape, 5> Shapes{{
+        {1, 1, 0, 1},
+        {7, 5, 1, 1},
+        {Solver::EquationCount, Solver::FileNameBits, 0, 1},
+        {130, 70, 6, 2},
+        {8192, 1024, 32, 4},
+    }};
+    std::mt19937_64 rng{0};  // Fixed so that a failure is reproducible.
+    for (const auto& s : Shapes)
+    {
+        const auto  independent_cols = s.cols - s.dependent_cols;
+        const auto  word_count       = (s.cols + gf2::Matrix::WordBits - 1U) / gf2::Matrix::WordBits;
+        const auto  tail_mask        = ~gf2::Matrix::Word{} >> ((word_count * gf2::Matrix::WordBits) - s.cols);
+        gf2::Matrix a(s.rows, s.cols);
+        gf2::Matrix x0(1, s.cols);
+        for (std::size_t i = 0; i < s.rows; i++)
+        {
+            std::generate(a.row(i), a.row(i) + word_count, std::ref(rng));
+            a.row(i)[word_count - 1U] &= tail_mask;
+        }
+        std::generate(x0.row(0), x0.row(0) + word_count, std::ref(rng));
+        x0.row(0)[word_count - 1U] &= tail_mask;
+        for (std::size_t j = independent_cols; j < s.cols; j++)
+        {
+            const auto p = rng() % independent_cols;
+            const auto q = rng() % independent_cols;
+            for (std::size_t i = 0; i < s.rows; i++)
+            {
+                a.set(i, j, a.get(i, p) != a.get(i, q));
+            }
+        }
+        const auto b        = multiply(a, x0.row(0));
+        const auto solution = gf2::solve(a, b, s.thread_count);
+        if (!solution || (solution->null_space.rows() < s.dependent_cols))
+        {
+            std::abort();
+        }
+        const auto ax = multiply(a, solution->x.row(0));
+        for (std::size_t i = 0; i < s.rows; i++)
+        {
+            if (ax.get(i, 0) != b.get(i, 0))
+            {
+                std::abort();
+            }
+        }
+        for (std::size_t k = 0; k < solution->null_space.rows(); k++)
+        {
+            const auto an = multiply(a, solution->null_space.row(k));
+            for (std::size_t i = 0; i < s.rows; i++)
+            {
+                if (an.get(i, 0))
+                {
+                    std::abort();
+                }
+            }
+        }
+    }
+}
+
+/// The options that take a value, all of them related to the request emission; see the README.
+constexpr std::array<std::string_view, 5> KnownOptions{"candump", "slcan", "socketcan", "iface", "transfer-id"};
+
+/// Emits the BeginFirmwareUpdate request carrying the forged file name in the formats requested via the options.
+/// The request is sent on behalf of the firmware server node, as the DroneCAN GUI Tool would do it.
+void emitRequest(const layout::Request& req, const std::map<std::string, std::string>& options)
+{
+    std::vector<std::uint8_t> path(req.uavcan_file_name.begin(), req.uavcan_file_name.end());
+    while (!path.empty() && (path.back() == 0))  // Trailing zeros have no effect on the shared struct.
+    {
+        path.pop_back();
+    }
+    const auto transfer_id = options.contains("transfer-id") ? std::stoul(options.at("transfer-id")) : 0UL;
+    const auto frames      = dronecan::makeServiceRequestFrames(
+        dronecan::begin_firmware_update::DefaultPriority,
+        dronecan::begin_firmware_update::ServiceTypeID,
+        dronecan::begin_firmware_update::DataTypeSignature,
+        req.uavcan_fw_server_node_id,
+        req.uavcan_node_id,
+        static_cast<std::uint8_t>(transfer_id),
+        dronecan::begin_firmware_update::serializeRequest(req.uavcan_fw_server_node_id, path));
+    const auto iface = options.contains("iface") ? options.at("iface") : std::string("can0");
+    std::cerr << "BeginFirmwareUpdate request (candump log format):\n";
+    dronecan::printCandumpLog(std::cerr, iface, frames);
+    const auto save = [](const std::string& file_name, const auto& write)
+    {
+        std::ofstream f(file_name, std::ios::binary);
+        write(f);
+        f.close();
+        if (!f)
+        {
+            throw std::runtime_error("Could not write " + file_name);
+        }
+    };
+    if (options.contains("candump"))
+    {
+        save(options.at("candump"), [&](std::ostream& os) { dronecan::printCandumpLog(os, iface, frames); });
+    }
+    if (options.contains("slcan"))
+    {
+        save(options.at("slcan"), [&](std::ostream& os) { dronecan::printSLCAN(os, frames); });
+    }
+    if (options.contains("socketcan"))
+    {
+        save(options.at("socketcan"), [&](std::ostream& os) { dronecan::writeSocketCAN(os, frames); });
     }
-    const auto                                              msg = composeWithLeadingCRC(obj);
-    std::array<std::uint8_t, sizeof(app_shared::LegacyV02)> shifted{};
-    std::copy(msg.begin(), msg.begin() + shifted.size(), shifted.begin());
-    hash::CRC64WE crc;
-    crc.update(shifted.data(), shifted.size());
-    *out_hash = makeBigInt(crc.get());
 }
 
 }  // namespace
@@ -65,20 +219,50 @@ void forgeH(const std::size_t flip_bit_index, ::bigint* const out_hash) noexcept
 
 int main(const int argc, const char* const argv[])
 {
-    using solver::g_obj;
-    const std::vector<std::string> args(argv + 1, argv + argc);
+    using solver::g_req;
+    solver::testCRC16CCITT();
+    solver::testGF2();
+    std::vector<std::string>           args;
+    std::map<std::string, std::string> options;  // --name value
     try
     {
-        g_obj.can_bus_speed            = static_cast<std::uint32_t>(std::stoul(args.at(0)));
-        g_obj.uavcan_node_id           = static_cast<std::uint8_t>(std::stoul(args.at(1)));
-        g_obj.uavcan_fw_server_node_id = static_cast<std::uint8_t>(std::stoul(args.at(2)));
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string a(argv[i]);
+            if (a.starts_with("--"))
+            {
+                const auto name = a.substr(2);
+                if (std::find(solver::KnownOptions.begin(), solver::KnownOptions.end(), name) ==
+                    solver::KnownOptions.end())
+                {
+                    throw std::invalid_argument("unknown option " + a);
+                }
+                if ((i + 1) >= argc)
+                {
+                    throw std::invalid_argument(a + " requires a value");
+                }
+                options[name] = argv[++i];
+            }
+            else
+            {
+                args.push_back(a);
+            }
+        }
+        if (options.contains("transfer-id") && (std::stoul(options.at("transfer-id")) > dronecan::TransferIDMax))
+        {
+            throw std::invalid_argument("the transfer-ID shall not exceed " +
+                                        std::to_string(static_cast<unsigned>(dronecan::TransferIDMax)));
+        }
+        g_req.can_bus_speed            = static_cast<std::uint32_t>(std::stoul(args.at(0)));
+        g_req.uavcan_node_id           = static_cast<std::uint8_t>(std::stoul(args.at(1)));
+        g_req.uavcan_fw_server_node_id = static_cast<std::uint8_t>(std::stoul(args.at(2)));
         try
         {
-            g_obj.stay_in_bootloader = std::stoul(args.at(3)) != 0;
+            g_req.stay_in_bootloader = std::stoul(args.at(3)) != 0;
         }
         catch (const std::out_of_range&)
         {
-            g_obj.stay_in_bootloader = true;
+            g_req.stay_in_bootloader = true;
         }
     }
     catch (const std::exception& ex)
@@ -86,51 +270,76 @@ int main(const int argc, const char* const argv[])
         std::cerr << "Invalid usage: " << ex.what() << std::endl;
         return 1;
     }
-    std::cerr << "Seed:\n" << g_obj << std::endl;
-    const ::bigint               target_checksum = solver::makeBigInt<std::uint64_t>(0);
-    std::array<std::size_t, 64U> flippable_bits_indices{};
-    const auto                   name_offset = (hash::CRC64WE::Size + solver::NameOffsetBytes) * CHAR_BIT;
-    std::iota(flippable_bits_indices.begin(), flippable_bits_indices.end(), name_offset);
-    const auto forge_result = ::forge(sizeof(app_shared::LegacyV02),  // length specified in bytes!
-                                      &target_checksum,
-                                      &solver::forgeH,
-                                      flippable_bits_indices.data(),
-                                      flippable_bits_indices.size(),
-                                      nullptr);  // bug https://github.com/resilar/crchack/issues/10
-    if (forge_result >= 0)
-    {
-        std::cerr << "Solution found with " << forge_result << " bits flipped" << std::endl;
-        auto obj = g_obj;
-        for (std::size_t i = 0; i < static_cast<std::size_t>(forge_result); i++)
+    std::cerr << "Seed:\n" << g_req << std::endl;
+    const auto name_offset = solver::Writer::ImageFileNameOffset * CHAR_BIT;
+#if PERF_COUNTERS
+    const perf::Counters counters;
+    const auto           perf_before = counters.read();
+#endif
+    const auto solution = solver::Solver::solve(g_req);
+#if PERF_COUNTERS
+    {
+        const auto perf_delta = counters.read() - perf_before;
+        std::cerr << "Solver::solve(): ";
+        counters.report(std::cerr, perf_delta, 1.0, "call");
+        std::cerr << "; ";
+        counters.report(std::cerr, perf_delta, static_cast<double>(solver::Solver::VariableCount), "bit");
+        std::cerr << (counters.isPrecise() ? "" : " (PMU unavailable, using TSC)") << std::endl;
+    }
+#endif
+    if (solution)
+    {
+        const auto  req          = solver::Solver::apply(g_req, *solution);
+        std::string flip_indices = "";
+        for (std::size_t j = 0; j < solver::Solver::VariableCount; j++)
         {
-            const auto idx = flippable_bits_indices.at(i);
-            std::cerr << idx << ",";
-            // const auto pos = (flip_bit_index & ~7U) | (7U - (flip_bit_index & 7U)); // if CRC is reflected
-            const auto pos         = idx;
-            const auto pos_in_name = pos - (solver::NameOffsetBytes + hash::CRC64WE::Size) * CHAR_BIT;
-            *reinterpret_cast<std::uint8_t*>(obj.uavcan_file_name.data() + (pos_in_name / CHAR_BIT)) ^=
-                (1U << (pos_in_name % CHAR_BIT));
+            if (solution->get(j))
+            {
+                flip_indices += std::to_string(name_offset + j) + ",";
+            }
         }
+        // The general solver is off the hot path; it only reports how much freedom is left for downstream searches.
+        const auto [a, b]  = solver::buildSystem(g_req);
+        const auto general = gf2::solve(a, b, std::max(1U, std::thread::hardware_concurrency()));
+        const auto dof     = general ? general->null_space.rows() : 0U;
+        std::cerr << "Solution found with " << solution->count() << " bits flipped; "
+                  << "degrees of freedom in the file name: " << dof << std::endl;
+        std::cerr << flip_indices;
         std::cerr << std::endl;
-        const auto out = composeWithLeadingCRC(obj);
+        const auto out = solver::Writer::write(req);
         std::cout.write(reinterpret_cast<const char*>(out.data()), out.size());
 
-        std::array<std::uint8_t, hash::CRC64WE::Size + sizeof(app_shared::LegacyV02)> test_buffer{};
+        // The self-check covers every view the solver was built for; the legacy bootloader is also checked with its
+        // own parser whenever it is among the views.
+        // The buffer is large enough for both the written image and the legacy parser, whichever is larger.
+        std::array<std::uint8_t, std::max(solver::Writer::ImageSize, layout::LegacyV02Bootloader::ImageSize)>
+            test_buffer{};
         std::copy(out.begin(), out.end(), test_buffer.begin());
-        if (const auto parsed = app_shared::parseWithTrailingCRC<app_shared::LegacyV02>(test_buffer.data()))
+        const auto parsed = app_shared::parseWithTrailingCRC<app_shared::LegacyV02>(test_buffer.data());
+        if (solver::Solver::residual(req).isZero() && (parsed || !solver::Solver::Includes<layout::LegacyV02View>))
         {
-            std::cerr << "\nParsed as seen by the bootloader (FYI, do not use):\n" << *parsed << std::endl;
+            if (parsed)
+            {
+                std::cerr << "\nParsed as seen by the bootloader (FYI, do not use):\n" << *parsed << std::endl;
+            }
             std::cerr << "USE THIS FILE NAME: {";
             std::ostringstream oss;
-            for (std::size_t i = name_offset / 8U;
-                 i < (name_offset / 8U + app_shared::LegacyV02().uavcan_file_name.size());
-                 i++)
+            for (std::size_t i = name_offset / 8U; i < (name_offset / 8U + solver::Writer::FileName.size); i++)
             {
                 oss.width(2);
                 oss.fill('0');
                 oss << std::hex << (static_cast<std::uint16_t>(out.at(i)) & 0xFFU) << ',';
             }
             std::cerr << oss.str() << "}\n";
+            try
+            {
+                solver::emitRequest(req, options);
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "Could not emit the request: " << ex.what() << std::endl;
+                return 1;
+            }
         }
         else
         {
@@ -139,7 +348,7 @@ int main(const int argc, const char* const argv[])
     }
     else
     {
-        std::cerr << "No solution found; error " << forge_result << std::endl;
+        std::cerr << "No solution found" << std::endl;
     }
     return 0;
 }